@@ -0,0 +1,102 @@
+#include "instance_generator.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+
+using namespace std;
+
+json generate_instance(const GeneratorOptions &opts)
+{
+    static const char *day_names[] = {"Mon", "Tue", "Wed", "Thu", "Fri", "Sat", "Sun"};
+    mt19937_64 rng(opts.seed);
+    auto uniform = [&](int lo, int hi)
+    { return uniform_int_distribution<int>(lo, max(lo, hi))(rng); };
+    bernoulli_distribution eligible_draw(min(1.0, max(0.0, opts.eligibility_density)));
+    discrete_distribution<int> periods_draw(opts.required_periods_mix.begin(), opts.required_periods_mix.end());
+
+    const int T = max(1, opts.teachers);
+    const int C = max(1, opts.courses);
+    const int L = max(1, opts.days);
+    const int M = max(1, opts.periods);
+
+    vector<string> days, periods;
+    for (int l = 0; l < L; ++l)
+        days.push_back(l < 7 ? day_names[l] : "D" + to_string(l + 1));
+    for (int m = 0; m < M; ++m)
+        periods.push_back(to_string(m + 1));
+
+    // eligibility: a guaranteed cover (course j -> teacher j % T, teacher i -> course i % C) plus random edges
+    vector<vector<char>> eligible(T, vector<char>(C, 0));
+    for (int j = 0; j < C; ++j)
+        eligible[j % T][j] = 1;
+    for (int i = 0; i < T; ++i)
+        eligible[i][i % C] = 1;
+    for (int i = 0; i < T; ++i)
+        for (int j = 0; j < C; ++j)
+            if (eligible_draw(rng))
+                eligible[i][j] = 1;
+
+    // Courses
+    json courses = json::array();
+    long long demand = 0;
+    int teachers_per_course = (T + C - 1) / C; // enough seats for every teacher to get a course
+    for (int j = 0; j < C; ++j)
+    {
+        json jc;
+        jc["id"] = "C" + to_string(j);
+        jc["name"] = "Course " + to_string(j);
+        jc["min_teachers"] = 1;
+        jc["max_teachers"] = teachers_per_course + uniform(0, 1);
+        json sections = json::array();
+        int n = uniform(max(1, opts.min_sections), opts.max_sections);
+        for (int k = 0; k < n; ++k)
+        {
+            int r = min(M, 1 + periods_draw(rng));
+            demand += r;
+            sections.push_back({{"id", "S" + to_string(k)}, {"required_periods", r}});
+        }
+        jc["sections"] = sections;
+        courses.push_back(jc);
+    }
+
+    // Teachers
+    json teachers = json::array();
+    for (int i = 0; i < T; ++i)
+    {
+        json jt;
+        jt["id"] = "T" + to_string(i);
+        jt["name"] = "Teacher " + to_string(i);
+        jt["max_courses"] = uniform(opts.min_max_courses, opts.max_max_courses);
+        json eligible_courses = json::array();
+        json course_prefs = json::object();
+        for (int j = 0; j < C; ++j)
+            if (eligible[i][j])
+            {
+                eligible_courses.push_back("C" + to_string(j));
+                course_prefs["C" + to_string(j)] = uniform(1, 10);
+            }
+        jt["eligible_courses"] = eligible_courses;
+        jt["course_preferences"] = course_prefs;
+        json time_prefs = json::object();
+        for (const auto &d : days)
+            for (const auto &p : periods)
+                time_prefs[d][p] = uniform(0, 10);
+        jt["day_time_preferences"] = time_prefs;
+        teachers.push_back(jt);
+    }
+
+    // Classrooms: the same count in every slot, sized so demand / capacity ~ tightness
+    double tightness = opts.capacity_tightness > 0 ? opts.capacity_tightness : 1.0;
+    int per_slot = max(1, (int)ceil(demand / (tightness * L * M)));
+    json clm = json::object();
+    for (const auto &d : days)
+        for (const auto &p : periods)
+            clm[d][p] = per_slot;
+
+    json instance;
+    instance["classrooms"] = {{"days", days}, {"periods", periods}, {"classrooms_per_slot", clm}};
+    instance["teachers"] = teachers;
+    instance["courses"] = courses;
+    return instance;
+}
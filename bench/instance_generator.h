@@ -0,0 +1,28 @@
+#pragma once
+#include <nlohmann/json.hpp>
+#include <cstdint>
+#include <vector>
+
+using json = nlohmann::json;
+using namespace std;
+
+// Tham số sinh bài toán ngẫu nhiên cho benchmark
+struct GeneratorOptions {
+    int teachers = 20;
+    int courses = 25;
+    int min_sections = 1;            // sections per course, uniform in [min_sections, max_sections]
+    int max_sections = 3;
+    double eligibility_density = 0.15; // chance that a teacher may teach a given course
+    vector<double> required_periods_mix{0.6, 0.3, 0.1}; // weight of sections needing 1, 2, 3, ... periods
+    double capacity_tightness = 0.6; // periods to schedule / classroom periods available
+    int days = 5;
+    int periods = 8;
+    int min_max_courses = 2;         // teacher max_courses, uniform in [min_max_courses, max_max_courses]
+    int max_max_courses = 4;
+    uint64_t seed = 1;
+};
+
+// A /schedule request body. Every teacher has at least one eligible course
+// and every course at least one eligible teacher; feasibility is likely but
+// not guaranteed for very tight settings.
+json generate_instance(const GeneratorOptions &opts);
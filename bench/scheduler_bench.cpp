@@ -0,0 +1,240 @@
+// scheduler_bench: times each stage of the pipeline on generated instances.
+//
+// One JSON object per instance and repetition is written to stdout (JSON
+// Lines); solver logs go to stderr. Example:
+//   scheduler_bench --sizes 10x12,40x50,120x150 --repeat 3 > results.jsonl
+//   scheduler_bench --generate --sizes 60x80 --seed 7 > instance.json
+//   scheduler_bench --sizes 600x800 --snapshot /tmp/bench.snap   # adds snapshot_load_ms
+#include "instance_generator.h"
+#include "scheduler/phase1.h"
+#include "scheduler/phase2_model.h"
+#include "scheduler/phase3.h"
+#include "scheduler/snapshot.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace operations_research::sat;
+using namespace std;
+
+namespace
+{
+    struct BenchOptions {
+        vector<pair<int, int>> sizes{{10, 12}, {40, 50}, {120, 150}}; // teachers x courses
+        GeneratorOptions generator;
+        int repeat = 1;
+        double phase2_time_limit = 30;
+        int phase2_workers = 8;
+        int phase3_iterations = 1200;
+        bool generate_only = false;
+        string snapshot_path; // scratch file for timing snapshot write and load, empty = skip
+    };
+
+    void usage()
+    {
+        cerr << "usage: scheduler_bench [options]\n"
+                "  --sizes TxC[,TxC...]     teachers x courses per instance (default 10x12,40x50,120x150)\n"
+                "  --sections MIN-MAX       sections per course (default 1-3)\n"
+                "  --density D              eligibility density (default 0.15)\n"
+                "  --periods-mix W1,W2,...  weights of sections needing 1, 2, ... periods (default 0.6,0.3,0.1)\n"
+                "  --tightness T            periods to schedule / classroom periods (default 0.6)\n"
+                "  --days N --periods N     timetable shape (default 5 x 8)\n"
+                "  --seed N                 generator and solver seed (default 1)\n"
+                "  --repeat N               runs per size (default 1)\n"
+                "  --phase2-time-limit S    CP-SAT time limit (default 30)\n"
+                "  --phase2-workers N       CP-SAT workers (default 8)\n"
+                "  --phase3-iterations N    Phase 3 iterations, single search (default 1200)\n"
+                "  --snapshot PATH          also time writing and loading a problem snapshot through PATH\n"
+                "  --generate               print the first instance as JSON and exit\n";
+    }
+
+    vector<string> split(const string &s, char sep)
+    {
+        vector<string> out;
+        stringstream ss(s);
+        string item;
+        while (getline(ss, item, sep))
+            out.push_back(item);
+        return out;
+    }
+
+    BenchOptions parse_args(int argc, char **argv)
+    {
+        BenchOptions b;
+        for (int k = 1; k < argc; ++k)
+        {
+            string arg = argv[k];
+            auto value = [&]() -> string
+            {
+                if (k + 1 >= argc)
+                    throw runtime_error("missing value for " + arg);
+                return argv[++k];
+            };
+            if (arg == "--sizes")
+            {
+                b.sizes.clear();
+                for (const auto &size : split(value(), ','))
+                {
+                    auto parts = split(size, 'x');
+                    if (parts.size() != 2)
+                        throw runtime_error("bad size: " + size);
+                    b.sizes.push_back({stoi(parts[0]), stoi(parts[1])});
+                }
+            }
+            else if (arg == "--sections")
+            {
+                auto parts = split(value(), '-');
+                b.generator.min_sections = stoi(parts.at(0));
+                b.generator.max_sections = stoi(parts.size() > 1 ? parts[1] : parts[0]);
+            }
+            else if (arg == "--density")
+                b.generator.eligibility_density = stod(value());
+            else if (arg == "--periods-mix")
+            {
+                b.generator.required_periods_mix.clear();
+                for (const auto &w : split(value(), ','))
+                    b.generator.required_periods_mix.push_back(stod(w));
+            }
+            else if (arg == "--tightness")
+                b.generator.capacity_tightness = stod(value());
+            else if (arg == "--days")
+                b.generator.days = stoi(value());
+            else if (arg == "--periods")
+                b.generator.periods = stoi(value());
+            else if (arg == "--seed")
+                b.generator.seed = stoull(value());
+            else if (arg == "--repeat")
+                b.repeat = max(1, stoi(value()));
+            else if (arg == "--phase2-time-limit")
+                b.phase2_time_limit = stod(value());
+            else if (arg == "--phase2-workers")
+                b.phase2_workers = stoi(value());
+            else if (arg == "--phase3-iterations")
+                b.phase3_iterations = stoi(value());
+            else if (arg == "--snapshot")
+                b.snapshot_path = value();
+            else if (arg == "--generate")
+                b.generate_only = true;
+            else if (arg == "--help" || arg == "-h")
+            {
+                usage();
+                exit(0);
+            }
+            else
+                throw runtime_error("unknown option: " + arg);
+        }
+        return b;
+    }
+
+    double ms_since(chrono::steady_clock::time_point t)
+    {
+        return chrono::duration<double, milli>(chrono::steady_clock::now() - t).count();
+    }
+
+    json run_once(const BenchOptions &b, const GeneratorOptions &gen, int rep)
+    {
+        json row;
+        row["teachers"] = gen.teachers;
+        row["courses"] = gen.courses;
+        row["seed"] = gen.seed;
+        row["repeat"] = rep;
+
+        string text = generate_instance(gen).dump();
+
+        // Phase 1: JSON text -> ProblemData (including the compiled form)
+        auto t = chrono::steady_clock::now();
+        ProblemData data = initialize_problem_from_json(json::parse(text));
+        row["parse_ms"] = ms_since(t);
+        row["sections"] = data.compiled.num_sections;
+
+        // the same problem through a binary snapshot instead of JSON
+        if (!b.snapshot_path.empty())
+        {
+            t = chrono::steady_clock::now();
+            write_snapshot(data.compiled, b.snapshot_path);
+            row["snapshot_write_ms"] = ms_since(t);
+            t = chrono::steady_clock::now();
+            ProblemData loaded = problem_from_snapshot(b.snapshot_path);
+            row["snapshot_load_ms"] = ms_since(t);
+        }
+
+        // Phase 2: model build and CP-SAT solve, timed separately
+        t = chrono::steady_clock::now();
+        Phase2Model pm;
+        build_phase2_model(data.compiled, pm, false, ModelScope(), true); // as Phase 2 without a warm start
+        row["phase2_build_ms"] = ms_since(t);
+        row["phase2_variables"] = pm.y.size() + pm.p.size();
+        row["phase2_orderings"] = pm.orderings;
+
+        SatParameters params;
+        params.set_max_time_in_seconds(b.phase2_time_limit);
+        params.set_num_search_workers(b.phase2_workers);
+        params.set_random_seed((int)(gen.seed & 0x7fffffff));
+        params.set_log_search_progress(false);
+        t = chrono::steady_clock::now();
+        CpSolverResponse response = solve_phase2_model(pm, params, SolveControl());
+        row["phase2_solve_ms"] = ms_since(t);
+        row["phase2_status"] = CpSolverStatus_Name(response.status());
+        if (!has_solution(response))
+            return row;
+        row["phase2_objective"] = response.objective_value();
+        InitialSolution init = solution_from_response(data.compiled, pm, response);
+
+        // Phase 3: a single seeded search with a fixed iteration budget
+        Phase3Options p3;
+        p3.threads = 1;
+        p3.has_seed = true;
+        p3.seed = gen.seed;
+        p3.max_iterations = b.phase3_iterations;
+        t = chrono::steady_clock::now();
+        OptimalSolution opt = find_optimal_solution(data, init, p3);
+        double p3_ms = ms_since(t);
+        row["phase3_ms"] = p3_ms;
+        row["phase3_iterations"] = opt.iterations;
+        row["phase3_iterations_per_second"] = p3_ms > 0 ? opt.iterations * 1000.0 / p3_ms : 0.0;
+        row["phase3_objective"] = opt.objective_value;
+        return row;
+    }
+} // anonymous namespace
+
+int main(int argc, char **argv)
+{
+    BenchOptions b;
+    try
+    {
+        b = parse_args(argc, argv);
+    }
+    catch (const exception &ex)
+    {
+        cerr << ex.what() << "\n";
+        usage();
+        return 2;
+    }
+
+    // keep stdout for results: everything the solver prints goes to stderr
+    ostream results(cout.rdbuf());
+    cout.rdbuf(cerr.rdbuf());
+
+    for (const auto &size : b.sizes)
+    {
+        GeneratorOptions gen = b.generator;
+        gen.teachers = size.first;
+        gen.courses = size.second;
+        if (b.generate_only)
+        {
+            results << generate_instance(gen).dump(2) << endl;
+            return 0;
+        }
+        for (int rep = 0; rep < b.repeat; ++rep)
+        {
+            GeneratorOptions g = gen;
+            g.seed = gen.seed + rep;
+            results << run_once(b, g, rep).dump() << endl;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,332 @@
+// scheduler_cli: solve /schedule request files without the HTTP server.
+//
+//   scheduler_cli [options] INPUT...
+//
+// An INPUT ending in .jsonl holds one request per line and produces
+// NAME.solutions.jsonl with one response per line, in input order. Any other
+// INPUT is a single request and produces NAME.solution.json; a problem snapshot
+// (see snapshot.h) is solved with the --defaults options. Responses have the
+// /schedule layout; a failed request, or a line that is not valid JSON, gets
+// {"status": "error", ...}.
+// Requests from all inputs are solved in parallel.
+//
+// --to-snapshot / --to-json only convert each INPUT (a request file or a
+// snapshot) to NAME.snap / NAME.json and exit.
+#include "scheduler/scheduler.h"
+#include "scheduler/snapshot.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    struct CliOptions {
+        vector<string> inputs;
+        string output_dir; // empty = next to each input
+        int jobs = 0;      // 0 = one per hardware thread
+        string defaults_file;
+        bool quiet = false;
+        string convert; // "snapshot" or "json": convert the inputs instead of solving
+    };
+
+    void usage()
+    {
+        cerr << "usage: scheduler_cli [options] INPUT...\n"
+                "  -o, --output DIR   write solutions into DIR (default: next to each input)\n"
+                "  -j, --jobs N       requests solved in parallel (default: hardware threads)\n"
+                "  --defaults FILE    default request options, same layout as \"options\"\n"
+                "                     (e.g. {\"phase2\": {\"workers\": 1}} when running many jobs)\n"
+                "  -q, --quiet        drop solver logs (they go to stderr otherwise)\n"
+                "  --to-snapshot      write each request as a binary problem snapshot NAME.snap\n"
+                "  --to-json          write each snapshot back as a request NAME.json\n";
+    }
+
+    CliOptions parse_args(int argc, char **argv)
+    {
+        CliOptions o;
+        for (int k = 1; k < argc; ++k)
+        {
+            string arg = argv[k];
+            auto value = [&]() -> string
+            {
+                if (k + 1 >= argc)
+                    throw runtime_error("missing value for " + arg);
+                return argv[++k];
+            };
+            if (arg == "-o" || arg == "--output")
+                o.output_dir = value();
+            else if (arg == "-j" || arg == "--jobs")
+                o.jobs = stoi(value());
+            else if (arg == "--defaults")
+                o.defaults_file = value();
+            else if (arg == "-q" || arg == "--quiet")
+                o.quiet = true;
+            else if (arg == "--to-snapshot")
+                o.convert = "snapshot";
+            else if (arg == "--to-json")
+                o.convert = "json";
+            else if (arg == "-h" || arg == "--help")
+            {
+                usage();
+                exit(0);
+            }
+            else if (!arg.empty() && arg[0] == '-')
+                throw runtime_error("unknown option: " + arg);
+            else
+                o.inputs.push_back(arg);
+        }
+        if (o.inputs.empty())
+            throw runtime_error("no input files");
+        return o;
+    }
+
+    bool ends_with(const string &s, const string &suffix)
+    {
+        return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    // One input file and the responses for its requests
+    struct InputFile {
+        string path;
+        string output_path;
+        bool lines = false;    // .jsonl
+        bool snapshot = false; // binary problem snapshot, one request without options
+        vector<json> requests;
+        vector<string> parse_errors; // per request, empty when it parsed
+        vector<int> line_numbers;    // per request of a .jsonl, its line in the file
+        vector<json> responses;
+        atomic<int> remaining{0};
+    };
+
+    string output_path_for(const string &input, const string &suffix, const string &output_dir)
+    {
+        string base = input;
+        size_t slash = base.find_last_of('/');
+        string dir = slash == string::npos ? string(".") : base.substr(0, slash);
+        if (slash != string::npos)
+            base = base.substr(slash + 1);
+        size_t dot = base.find_last_of('.');
+        if (dot != string::npos)
+            base = base.substr(0, dot);
+        return (output_dir.empty() ? dir : output_dir) + "/" + base + suffix;
+    }
+
+    void write(const InputFile &f)
+    {
+        ofstream out(f.output_path);
+        if (!out)
+            throw runtime_error("cannot write " + f.output_path);
+        if (f.lines)
+            for (const auto &r : f.responses)
+                out << r.dump() << "\n";
+        else
+            out << f.responses[0].dump(2) << "\n";
+    }
+
+    void load(InputFile &f)
+    {
+        if (f.snapshot)
+        {
+            f.requests.resize(1); // read by the worker, loading takes milliseconds
+            f.responses.resize(1);
+            f.remaining = 1;
+            return;
+        }
+        ifstream in(f.path);
+        if (!in)
+            throw runtime_error("cannot open " + f.path);
+        // a malformed request only fails itself, its response keeps its place in the output
+        auto add = [&f](const string &where, auto &&source)
+        {
+            try
+            {
+                f.requests.push_back(json::parse(source));
+                f.parse_errors.emplace_back();
+            }
+            catch (const json::parse_error &ex)
+            {
+                f.requests.emplace_back();
+                f.parse_errors.push_back(where + ex.what());
+            }
+        };
+        if (f.lines)
+        {
+            string line;
+            for (int number = 1; getline(in, line); ++number)
+                if (line.find_first_not_of(" \t\r") != string::npos)
+                {
+                    add("line " + to_string(number) + ": ", line);
+                    f.line_numbers.push_back(number);
+                }
+        }
+        else
+            add("", in);
+        f.responses.resize(f.requests.size());
+        f.remaining = (int)f.requests.size();
+        // no request will finish and write it, so the (empty) output is written now
+        if (f.requests.empty())
+            write(f);
+    }
+
+    // --to-snapshot / --to-json for one input
+    void convert(const string &path, const CliOptions &opts)
+    {
+        if (opts.convert == "snapshot")
+        {
+            if (is_snapshot(path) || ends_with(path, ".jsonl"))
+                throw runtime_error(path + ": --to-snapshot needs a single request file");
+            ifstream in(path);
+            if (!in)
+                throw runtime_error("cannot open " + path);
+            string out = output_path_for(path, ".snap", opts.output_dir);
+            write_snapshot(initialize_problem_from_json(json::parse(in)).compiled, out);
+            cout << path << " -> " << out << endl;
+        }
+        else
+        {
+            if (!is_snapshot(path))
+                throw runtime_error(path + ": --to-json needs a snapshot");
+            string out_path = output_path_for(path, ".json", opts.output_dir);
+            ofstream out(out_path);
+            if (!out)
+                throw runtime_error("cannot write " + out_path);
+            out << problem_to_json(read_snapshot(path)).dump(2) << "\n";
+            cout << path << " -> " << out_path << endl;
+        }
+    }
+} // anonymous namespace
+
+int main(int argc, char **argv)
+{
+    CliOptions opts;
+    vector<unique_ptr<InputFile>> files;
+    try
+    {
+        opts = parse_args(argc, argv);
+        if (!opts.defaults_file.empty())
+        {
+            ifstream in(opts.defaults_file);
+            if (!in)
+                throw runtime_error("cannot open " + opts.defaults_file);
+            set_default_options(json::parse(in));
+        }
+        for (const auto &path : opts.inputs)
+        {
+            auto f = make_unique<InputFile>();
+            f->path = path;
+            f->lines = ends_with(path, ".jsonl");
+            f->snapshot = is_snapshot(path);
+            f->output_path = output_path_for(path, f->lines ? ".solutions.jsonl" : ".solution.json", opts.output_dir);
+            if (!opts.convert.empty())
+            {
+                convert(path, opts);
+                continue;
+            }
+            load(*f);
+            files.push_back(std::move(f));
+        }
+        if (!opts.convert.empty())
+            return 0;
+    }
+    catch (const exception &ex)
+    {
+        cerr << "scheduler_cli: " << ex.what() << "\n";
+        usage();
+        return 2;
+    }
+
+    // progress lines go to stdout; solver logs to stderr, or nowhere with --quiet
+    ostream progress(cout.rdbuf());
+    cout.rdbuf(opts.quiet ? nullptr : cerr.rdbuf());
+
+    vector<pair<InputFile *, size_t>> tasks;
+    for (auto &f : files)
+        for (size_t r = 0; r < f->requests.size(); ++r)
+            tasks.push_back({f.get(), r});
+
+    int jobs = opts.jobs > 0 ? opts.jobs : (int)max(1u, thread::hardware_concurrency());
+    jobs = max(1, min(jobs, (int)tasks.size()));
+
+    mutex progress_m;
+    atomic<size_t> next{0};
+    atomic<int> failed{0};
+    auto batch_start = chrono::steady_clock::now();
+
+    auto worker = [&]
+    {
+        for (size_t t = next++; t < tasks.size(); t = next++)
+        {
+            InputFile &f = *tasks[t].first;
+            size_t r = tasks[t].second;
+            auto start = chrono::steady_clock::now();
+            json response;
+            try
+            {
+                if (!f.parse_errors.empty() && !f.parse_errors[r].empty())
+                    throw runtime_error(f.parse_errors[r]);
+                if (f.snapshot)
+                {
+                    OptimalSolution opt = solve_schedule(make_schedule_request(problem_from_snapshot(f.path)));
+                    response = {{"status", "success"}, {"solution", solution_to_json(opt)}};
+                }
+                else
+                    response = solve_schedule_request(f.requests[r]);
+            }
+            catch (const exception &ex)
+            {
+                response = {{"status", "error"}, {"message", ex.what()}};
+                ++failed;
+            }
+            for (const char *key : {"id", "request_id"})
+                if (f.requests[r].contains(key))
+                    response[key] = f.requests[r][key];
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+            {
+                lock_guard<mutex> lock(progress_m);
+                progress << f.path << (f.lines ? ":" + to_string(f.line_numbers[r]) : string()) << " "
+                         << response["status"].get<string>();
+                if (response.contains("solution"))
+                    progress << " objective " << response["solution"]["objective_value"];
+                progress << " " << seconds << "s" << endl;
+            }
+            f.responses[r] = std::move(response);
+
+            // the last request of a file writes it
+            if (--f.remaining == 0)
+            {
+                try
+                {
+                    write(f);
+                }
+                catch (const exception &ex)
+                {
+                    lock_guard<mutex> lock(progress_m);
+                    progress << "scheduler_cli: " << ex.what() << endl;
+                    ++failed;
+                }
+            }
+        }
+    };
+
+    vector<thread> pool;
+    for (int w = 0; w < jobs; ++w)
+        pool.emplace_back(worker);
+    for (auto &t : pool)
+        t.join();
+
+    progress << tasks.size() << " requests, " << failed << " failed, "
+             << chrono::duration<double>(chrono::steady_clock::now() - batch_start).count() << "s with "
+             << jobs << " jobs" << endl;
+    return failed > 0 ? 1 : 0;
+}
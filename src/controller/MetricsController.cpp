@@ -0,0 +1,17 @@
+#include "MetricsController.h"
+#include <drogon/drogon.h>
+
+#include "../service/Metrics.h"
+
+using namespace drogon;
+using namespace std;
+
+void MetricsController::metrics(const HttpRequestPtr &req,
+                                function<void(const HttpResponsePtr &)> &&callback)
+{
+    auto resp = HttpResponse::newHttpResponse();
+    resp->setStatusCode(k200OK);
+    resp->setContentTypeString("text/plain; version=0.0.4; charset=utf-8");
+    resp->setBody(Metrics::instance().render());
+    callback(resp);
+}
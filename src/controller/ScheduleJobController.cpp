@@ -0,0 +1,106 @@
+#include "ScheduleJobController.h"
+#include <drogon/drogon.h>
+#include <nlohmann/json.hpp>
+
+#include "../service/JobManager.h"
+#include "../service/Metrics.h"
+
+using json = nlohmann::json;
+using namespace drogon;
+using namespace std;
+
+static HttpResponsePtr json_response(HttpStatusCode code, const json &body)
+{
+    auto resp = HttpResponse::newHttpResponse();
+    resp->setStatusCode(code);
+    resp->setContentTypeCode(CT_APPLICATION_JSON);
+    resp->setBody(body.dump());
+    return resp;
+}
+
+static HttpResponsePtr error_response(HttpStatusCode code, const string &message)
+{
+    json err;
+    err["status"] = "error";
+    err["message"] = message;
+    return json_response(code, err);
+}
+
+void ScheduleJobController::submit(const HttpRequestPtr &req,
+                                   function<void(const HttpResponsePtr &)> &&callback)
+{
+    auto body = req->getBody();
+    if (body.empty())
+    {
+        LOG_WARN << "[Jobs] Empty body";
+        return callback(error_response(k400BadRequest, "empty body"));
+    }
+
+    json jin;
+    {
+        StageTimer timer("json_parse");
+        jin = json::parse(body, nullptr, false);
+    }
+    if (jin.is_discarded())
+        return callback(error_response(k400BadRequest, "invalid JSON"));
+
+    string id = JobManager::instance().submit(std::move(jin));
+    if (id.empty())
+    {
+        LOG_WARN << "[Jobs] Queue full, rejecting job";
+        return callback(error_response(k503ServiceUnavailable, "solver queue is full, retry later"));
+    }
+
+    LOG_INFO << "[Jobs] Queued job " << id;
+    json jout;
+    jout["status"] = "queued";
+    jout["job_id"] = id;
+    callback(json_response(k202Accepted, jout));
+}
+
+void ScheduleJobController::status(const HttpRequestPtr &req,
+                                   function<void(const HttpResponsePtr &)> &&callback,
+                                   const string &id)
+{
+    json jout;
+    if (!JobManager::instance().describe(id, jout))
+        return callback(error_response(k404NotFound, "unknown job id"));
+    HttpResponsePtr resp;
+    {
+        StageTimer timer("response_serialize");
+        resp = json_response(k200OK, jout);
+    }
+    callback(resp);
+}
+
+void ScheduleJobController::cancel(const HttpRequestPtr &req,
+                                   function<void(const HttpResponsePtr &)> &&callback,
+                                   const string &id)
+{
+    auto &jobs = JobManager::instance();
+    json jout;
+    if (!jobs.describe(id, jout))
+        return callback(error_response(k404NotFound, "unknown job id"));
+    if (!jobs.cancel(id))
+        return callback(error_response(k409Conflict, "job has already finished"));
+
+    LOG_INFO << "[Jobs] Cancellation requested for job " << id;
+    jobs.describe(id, jout);
+    callback(json_response(k200OK, jout));
+}
+
+void ScheduleJobController::accept(const HttpRequestPtr &req,
+                                   function<void(const HttpResponsePtr &)> &&callback,
+                                   const string &id)
+{
+    auto &jobs = JobManager::instance();
+    json jout;
+    if (!jobs.describe(id, jout))
+        return callback(error_response(k404NotFound, "unknown job id"));
+    if (!jobs.accept(id))
+        return callback(error_response(k409Conflict, "job is not running"));
+
+    LOG_INFO << "[Jobs] Early accept requested for job " << id;
+    jobs.describe(id, jout);
+    callback(json_response(k200OK, jout));
+}
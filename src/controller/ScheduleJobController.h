@@ -0,0 +1,32 @@
+#pragma once
+
+#include <drogon/HttpController.h>
+
+class ScheduleJobController : public drogon::HttpController<ScheduleJobController> {
+public:
+    METHOD_LIST_BEGIN
+    // POST /schedule/jobs
+    ADD_METHOD_TO(ScheduleJobController::submit, "/schedule/jobs", drogon::Post);
+    // GET /schedule/jobs/{id}
+    ADD_METHOD_TO(ScheduleJobController::status, "/schedule/jobs/{id}", drogon::Get);
+    // DELETE /schedule/jobs/{id}
+    ADD_METHOD_TO(ScheduleJobController::cancel, "/schedule/jobs/{id}", drogon::Delete);
+    // POST /schedule/jobs/{id}/accept
+    ADD_METHOD_TO(ScheduleJobController::accept, "/schedule/jobs/{id}/accept", drogon::Post);
+    METHOD_LIST_END
+
+    void submit(const drogon::HttpRequestPtr &req,
+                std::function<void (const drogon::HttpResponsePtr &)> &&callback);
+
+    void status(const drogon::HttpRequestPtr &req,
+                std::function<void (const drogon::HttpResponsePtr &)> &&callback,
+                const std::string &id);
+
+    void cancel(const drogon::HttpRequestPtr &req,
+                std::function<void (const drogon::HttpResponsePtr &)> &&callback,
+                const std::string &id);
+
+    void accept(const drogon::HttpRequestPtr &req,
+                std::function<void (const drogon::HttpResponsePtr &)> &&callback,
+                const std::string &id);
+};
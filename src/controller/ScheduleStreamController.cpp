@@ -0,0 +1,79 @@
+#include "ScheduleStreamController.h"
+#include <drogon/drogon.h>
+#include <nlohmann/json.hpp>
+
+#include "../service/JobManager.h"
+
+using json = nlohmann::json;
+using namespace drogon;
+using namespace std;
+
+// Per-connection state: the job solving this connection's request
+struct StreamSession
+{
+    string job_id;
+};
+
+static void send_event(const WebSocketConnectionPtr &conn, const json &event)
+{
+    if (conn->connected())
+        conn->send(event.dump());
+}
+
+void ScheduleStreamController::handleNewConnection(const HttpRequestPtr &req,
+                                                   const WebSocketConnectionPtr &conn)
+{
+    conn->setContext(make_shared<StreamSession>());
+}
+
+void ScheduleStreamController::handleNewMessage(const WebSocketConnectionPtr &conn,
+                                                string &&message,
+                                                const WebSocketMessageType &type)
+{
+    if (type != WebSocketMessageType::Text)
+        return;
+    auto session = conn->getContext<StreamSession>();
+    if (!session)
+        return;
+
+    json jin = json::parse(message, nullptr, false);
+    if (jin.is_discarded())
+        return send_event(conn, {{"event", "error"}, {"message", "invalid JSON"}});
+
+    auto &jobs = JobManager::instance();
+
+    // Control messages for the running solve
+    if (jin.contains("action"))
+    {
+        string action = jin.value("action", string());
+        bool ok = !session->job_id.empty() &&
+                  ((action == "accept" && jobs.accept(session->job_id)) ||
+                   (action == "cancel" && jobs.cancel(session->job_id)));
+        if (!ok)
+            send_event(conn, {{"event", "error"}, {"message", "cannot " + action + " now"}});
+        return;
+    }
+
+    if (!session->job_id.empty())
+        return send_event(conn, {{"event", "error"}, {"message", "a solve is already running on this connection"}});
+
+    weak_ptr<WebSocketConnection> weak = conn;
+    string id = jobs.submit(std::move(jin), [weak](const json &event)
+                            {
+        if (auto c = weak.lock())
+            send_event(c, event); });
+    if (id.empty())
+        return send_event(conn, {{"event", "error"}, {"message", "solver queue is full, retry later"}});
+
+    // "queued" was already sent by the job manager, ahead of any solver event
+    session->job_id = id;
+    LOG_INFO << "[Stream] Queued job " << id;
+}
+
+void ScheduleStreamController::handleConnectionClosed(const WebSocketConnectionPtr &conn)
+{
+    // Nobody is listening any more: free the solver
+    auto session = conn->getContext<StreamSession>();
+    if (session && !session->job_id.empty() && JobManager::instance().cancel(session->job_id))
+        LOG_INFO << "[Stream] Client left, cancelled job " << session->job_id;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <drogon/WebSocketController.h>
+
+// WebSocket /schedule/stream: the client sends a /schedule request body as
+// its first message and receives every improved schedule while it is solved.
+// Sending {"action": "accept"} ends the solve with the current best schedule,
+// {"action": "cancel"} abandons it.
+class ScheduleStreamController : public drogon::WebSocketController<ScheduleStreamController> {
+public:
+    WS_PATH_LIST_BEGIN
+    WS_PATH_ADD("/schedule/stream");
+    WS_PATH_LIST_END
+
+    void handleNewMessage(const drogon::WebSocketConnectionPtr &conn,
+                          std::string &&message,
+                          const drogon::WebSocketMessageType &type) override;
+
+    void handleNewConnection(const drogon::HttpRequestPtr &req,
+                             const drogon::WebSocketConnectionPtr &conn) override;
+
+    void handleConnectionClosed(const drogon::WebSocketConnectionPtr &conn) override;
+};
@@ -2,9 +2,9 @@
 #include <drogon/drogon.h>
 #include <nlohmann/json.hpp>
 
-#include "../scheduler/phase1.h"
-#include "../scheduler/phase2.h"
-#include "../scheduler/phase3.h"
+#include "../service/JobManager.h"
+#include "../service/Metrics.h"
+#include "../service/ResultCache.h"
 
 using json = nlohmann::json;
 using namespace drogon;
@@ -27,46 +27,39 @@ void TeacherSchedulerController::schedule(const HttpRequestPtr &req,
             return callback(resp);
         }
 
-        json jin = json::parse(body);
-        LOG_INFO << "[Schedule] JSON parsed successfully";
-
-        ProblemData data = initialize_problem_from_json(jin);
-        LOG_INFO << "[Schedule] ProblemData initialized: "
-                 << data.teachers.size() << " teachers, "
-                 << data.courses.size() << " courses";
-
-        InitialSolution init = construct_initial_solution(data);
-        LOG_INFO << "[Schedule] Initial solution constructed";
-
-        OptimalSolution opt = find_optimal_solution(data, init);
-        LOG_INFO << "[Schedule] Optimization finished. Objective value: " << opt.objective_value;
-
-        // Build response JSON
-        json jout;
-        jout["status"] = "success";
-        jout["solution"] = json::object();
-        jout["solution"]["objective_value"] = opt.objective_value;
-        jout["solution"]["assignments"] = json::array();
-
-        for (const auto &a : opt.assignments)
+        json jin;
         {
-            json ja;
-            ja["teacher_id"] = a.teacher_id;
-            ja["course_id"] = a.course_id;
-            ja["section_id"] = a.section_id;
-            ja["day"] = a.day;
-            ja["period"] = a.period;
-            jout["solution"]["assignments"].push_back(ja);
+            StageTimer timer("json_parse");
+            jin = json::parse(body);
         }
+        LOG_INFO << "[Schedule] JSON parsed successfully";
+
+        json jout = ResultCache::instance().solve(jin);
+        LOG_INFO << "[Schedule] Optimization finished. Objective value: " << jout["solution"]["objective_value"].get<int>();
 
         auto resp = HttpResponse::newHttpResponse();
         resp->setStatusCode(k200OK);
         resp->setContentTypeCode(CT_APPLICATION_JSON);
-        resp->setBody(jout.dump());
+        {
+            StageTimer timer("response_serialize");
+            resp->setBody(jout.dump());
+        }
         callback(resp);
 
         LOG_INFO << "[Schedule] Response sent to client";
     }
+    catch (const invalid_argument &ex)
+    {
+        LOG_WARN << "[Schedule] Invalid request: " << ex.what();
+        json err;
+        err["status"] = "error";
+        err["message"] = ex.what();
+        auto resp = HttpResponse::newHttpResponse();
+        resp->setStatusCode(k400BadRequest);
+        resp->setContentTypeCode(CT_APPLICATION_JSON);
+        resp->setBody(err.dump());
+        callback(resp);
+    }
     catch (const exception &ex)
     {
         LOG_ERROR << "[Schedule] Exception: " << ex.what();
@@ -80,3 +73,64 @@ void TeacherSchedulerController::schedule(const HttpRequestPtr &req,
         callback(resp);
     }
 }
+
+void TeacherSchedulerController::repair(const HttpRequestPtr &req,
+                                        function<void(const HttpResponsePtr &)> &&callback)
+{
+    auto respond = [](int code, const json &body) {
+        auto resp = HttpResponse::newHttpResponse();
+        resp->setStatusCode(static_cast<HttpStatusCode>(code));
+        resp->setContentTypeCode(CT_APPLICATION_JSON);
+        {
+            StageTimer timer("response_serialize");
+            resp->setBody(body.dump());
+        }
+        return resp;
+    };
+
+    auto body = req->getBody();
+    if (body.empty())
+    {
+        LOG_WARN << "[Repair] Empty body";
+        return callback(respond(400, {{"status", "error"}, {"message", "empty body"}}));
+    }
+
+    json jin;
+    {
+        StageTimer timer("json_parse");
+        jin = json::parse(body, nullptr, false);
+    }
+    if (jin.is_discarded())
+    {
+        LOG_WARN << "[Repair] Invalid JSON";
+        return callback(respond(400, {{"status", "error"}, {"message", "invalid JSON"}}));
+    }
+
+    // The solve runs on a JobManager worker so CP-SAT never blocks the event loop;
+    // the listener answers the request once the job is done.
+    auto cb = make_shared<function<void(const HttpResponsePtr &)>>(std::move(callback));
+    string id = JobManager::instance().submit(
+        std::move(jin),
+        [cb, respond](const json &event) {
+            if (event.value("event", "") != "done")
+                return;
+            string status = event.value("status", "");
+            if (status == "succeeded")
+            {
+                LOG_INFO << "[Repair] " << event["repair"].value("changed", 0) << " assignments changed, objective "
+                         << event["solution"].value("objective_value", 0LL);
+                (*cb)(respond(200, {{"status", "success"}, {"solution", event["solution"]}, {"repair", event["repair"]}}));
+                return;
+            }
+            string message = event.value("message", status);
+            int code = event.value("invalid_request", false) ? 400 : status == "cancelled" ? 503 : 500;
+            if (code == 400)
+                LOG_WARN << "[Repair] Invalid request: " << message;
+            else
+                LOG_ERROR << "[Repair] " << status << ": " << message;
+            (*cb)(respond(code, {{"status", "error"}, {"message", message}}));
+        },
+        JobManager::Kind::Repair);
+    if (id.empty())
+        (*cb)(respond(503, {{"status", "error"}, {"message", "solver queue is full, retry later"}}));
+}
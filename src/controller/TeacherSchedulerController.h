@@ -7,8 +7,13 @@ public:
     METHOD_LIST_BEGIN
     // POST /schedule
     ADD_METHOD_TO(TeacherSchedulerController::schedule, "/schedule", drogon::Post);
+    // POST /schedule/repair
+    ADD_METHOD_TO(TeacherSchedulerController::repair, "/schedule/repair", drogon::Post);
     METHOD_LIST_END
 
     void schedule(const drogon::HttpRequestPtr &req,
                   std::function<void (const drogon::HttpResponsePtr &)> &&callback);
+
+    void repair(const drogon::HttpRequestPtr &req,
+                std::function<void (const drogon::HttpResponsePtr &)> &&callback);
 };
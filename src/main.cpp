@@ -1,9 +1,33 @@
 #include <drogon/drogon.h>
+#include "service/JobManager.h"
+#include "service/ResultCache.h"
 using namespace drogon;
 
 int main() {
     app().loadConfigFile("config.json");
+
+    // Solver worker pool behind /schedule/jobs ("custom_config.jobs" in config.json)
+    const Json::Value &jobs = app().getCustomConfig()["jobs"];
+    JobManager::instance().start(jobs.get("workers", 2).asInt(),
+                                 jobs.get("queue_capacity", 32).asUInt(),
+                                 jobs.get("max_finished_jobs", 1000).asUInt());
+
+    // Default solver options for every request ("custom_config.solver", same layout as a request's "options")
+    const Json::Value &solver = app().getCustomConfig()["solver"];
+    if (solver.isObject())
+        set_default_options(json::parse(solver.toStyledString()));
+
+    // Cap on the threads a request may ask for in options.phase2/lns/phase3 ("custom_config.max_solver_threads")
+    max_solver_threads = app().getCustomConfig().get("max_solver_threads", 0).asInt();
+
+    // Result cache shared by /schedule and /schedule/jobs ("custom_config.cache")
+    const Json::Value &cache = app().getCustomConfig()["cache"];
+    ResultCache::instance().configure(cache.get("capacity", 256).asUInt(),
+                                      cache.get("ttl_seconds", 3600.0).asDouble());
+
     LOG_INFO << "Starting Teacher Scheduler Application at port 8080";
     app().run();
+
+    JobManager::instance().stop();
     return 0;
 }
@@ -0,0 +1,323 @@
+#include "lns.h"
+#include "objective.h"
+#include "phase2_model.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+using namespace operations_research::sat;
+using namespace std;
+
+namespace
+{
+    enum class Neighborhood
+    {
+        Day,
+        TeacherGroup,
+        CourseCluster
+    };
+    const int kNeighborhoods = 3;
+
+    const char *neighborhood_name(Neighborhood n)
+    {
+        switch (n)
+        {
+        case Neighborhood::Day:
+            return "day";
+        case Neighborhood::TeacherGroup:
+            return "teacher_group";
+        case Neighborhood::CourseCluster:
+            return "course_cluster";
+        }
+        return "unknown";
+    }
+
+    // Schedule as one PinnedStart per global section; false if some
+    // assignment does not map onto the problem or a section is missing
+    bool to_pinned(const CompiledProblem &cp, const InitialSolution &sol, vector<PinnedStart> &out)
+    {
+        out.assign(cp.num_sections, PinnedStart());
+        for (const auto &a : sol.assignments)
+        {
+            auto ti = cp.teacher_index.find(a.teacher_id);
+            auto ci = cp.course_index.find(a.course_id);
+            auto di = cp.day_index.find(a.day);
+            auto pi = cp.period_index.find(a.period);
+            if (ti == cp.teacher_index.end() || ci == cp.course_index.end() ||
+                di == cp.day_index.end() || pi == cp.period_index.end())
+                return false;
+            int s = cp.section_index(ci->second, a.section_id);
+            if (s < 0)
+                return false;
+            out[s] = {ti->second, di->second, pi->second};
+        }
+        for (const auto &pin : out)
+            if (pin.teacher < 0)
+                return false;
+        return true;
+    }
+
+    InitialSolution from_pinned(const CompiledProblem &cp, const vector<PinnedStart> &pinned)
+    {
+        InitialSolution sol;
+        for (int s = 0; s < cp.num_sections; ++s)
+        {
+            InitialSolution::Assignment a;
+            a.teacher_id = cp.teacher_ids[pinned[s].teacher];
+            a.course_id = cp.course_ids[cp.section_course[s]];
+            a.section_id = cp.section_ids[s];
+            a.day = cp.days[pinned[s].day];
+            a.period = cp.periods[pinned[s].start];
+            sol.assignments.push_back(a);
+        }
+        return sol;
+    }
+
+    // Sections to re-optimize for one neighborhood of the current schedule
+    vector<char> pick_neighborhood(const CompiledProblem &cp, const vector<PinnedStart> &current,
+                                   Neighborhood kind, int size, mt19937 &rng)
+    {
+        vector<char> freed(cp.num_sections, 0);
+        switch (kind)
+        {
+        case Neighborhood::Day:
+        {
+            int l = uniform_int_distribution<int>(0, cp.num_days - 1)(rng);
+            for (int s = 0; s < cp.num_sections; ++s)
+                freed[s] = current[s].day == l;
+            break;
+        }
+        case Neighborhood::TeacherGroup:
+        {
+            // a random teacher plus teachers eligible for the courses already in the group
+            vector<char> in_group(cp.num_teachers, 0);
+            vector<int> group{uniform_int_distribution<int>(0, cp.num_teachers - 1)(rng)};
+            in_group[group[0]] = 1;
+            for (size_t g = 0; g < group.size() && (int)group.size() < size; ++g)
+                for (int j = 0; j < cp.num_courses && (int)group.size() < size; ++j)
+                {
+                    if (!cp.eligible(group[g], j))
+                        continue;
+                    for (int i : cp.course_eligible_teachers[j])
+                        if (!in_group[i] && (int)group.size() < size)
+                        {
+                            in_group[i] = 1;
+                            group.push_back(i);
+                        }
+                }
+            for (int s = 0; s < cp.num_sections; ++s)
+                freed[s] = in_group[current[s].teacher];
+            break;
+        }
+        case Neighborhood::CourseCluster:
+        {
+            // a random course plus courses sharing an eligible teacher with the cluster
+            vector<char> in_cluster(cp.num_courses, 0);
+            vector<int> cluster{uniform_int_distribution<int>(0, cp.num_courses - 1)(rng)};
+            in_cluster[cluster[0]] = 1;
+            for (size_t c = 0; c < cluster.size() && (int)cluster.size() < size; ++c)
+                for (int i : cp.course_eligible_teachers[cluster[c]])
+                    for (int j = 0; j < cp.num_courses && (int)cluster.size() < size; ++j)
+                        if (!in_cluster[j] && cp.eligible(i, j))
+                        {
+                            in_cluster[j] = 1;
+                            cluster.push_back(j);
+                        }
+            for (int j : cluster)
+                for (int s = cp.course_section_begin[j]; s < cp.course_section_begin[j + 1]; ++s)
+                    freed[s] = 1;
+            break;
+        }
+        }
+        return freed;
+    }
+
+    // Re-solve the freed sections with everything else pinned, hinted with the
+    // current schedule. The model keeps every P and overload term, so the
+    // objective is the full Phase 2 objective.
+    bool solve_neighborhood(const CompiledProblem &cp, const vector<PinnedStart> &current, const vector<char> &freed,
+                            const SatParameters &params, const SolveControl &ctl,
+                            vector<PinnedStart> &out, double &objective)
+    {
+        ModelScope scope;
+        scope.pinned = current;
+        for (int s = 0; s < cp.num_sections; ++s)
+            if (freed[s])
+                scope.pinned[s].teacher = -1;
+
+        Phase2Model pm;
+        build_phase2_model(cp, pm, false, scope);
+        for (int s = 0; s < cp.num_sections; ++s)
+        {
+            if (!freed[s])
+                continue;
+            int hinted = pm.find_start(current[s].teacher, s, current[s].day, current[s].start);
+            for (int v : pm.by_section[s])
+                pm.builder.AddHint(pm.y[v].var, v == hinted);
+        }
+
+        auto solve_start = chrono::steady_clock::now();
+        CpSolverResponse response = solve_phase2_model(pm, params, ctl);
+        if (ctl.stats)
+        {
+            ctl.stats->add_duration("lns_solve", chrono::duration<double>(chrono::steady_clock::now() - solve_start).count());
+            ctl.stats->add_cpsat_status("lns", CpSolverStatus_Name(response.status()));
+        }
+        if (!has_solution(response))
+            return false;
+        out = current;
+        for (const auto &sv : pm.y)
+            if (SolutionBooleanValue(response, sv.var))
+                out[sv.section] = {sv.teacher, sv.day, sv.start};
+        objective = response.objective_value();
+        return true;
+    }
+
+    uint64_t thread_seed(const LnsOptions &opts, int worker)
+    {
+        if (!opts.has_seed)
+            return random_device{}() ^ (uint64_t)chrono::steady_clock::now().time_since_epoch().count();
+        seed_seq seq{(uint32_t)opts.seed, (uint32_t)(opts.seed >> 32), (uint32_t)worker};
+        uint32_t out[2];
+        seq.generate(out, out + 2);
+        return ((uint64_t)out[0] << 32) | out[1];
+    }
+} // anonymous namespace
+
+LnsOptions lns_options_from_json(const json &j)
+{
+    if (!j.is_object())
+        throw invalid_argument("options.lns must be an object");
+    LnsOptions opts;
+    try
+    {
+        opts.enabled = j.value("enabled", opts.enabled);
+        opts.time_limit_seconds = j.value("time_limit_seconds", opts.time_limit_seconds);
+        opts.neighborhood_time_limit_seconds = j.value("neighborhood_time_limit_seconds", opts.neighborhood_time_limit_seconds);
+        opts.threads = j.value("threads", opts.threads);
+        opts.workers = j.value("workers", opts.workers);
+        opts.neighborhood_size = j.value("neighborhood_size", opts.neighborhood_size);
+        opts.max_neighborhoods = j.value("max_neighborhoods", opts.max_neighborhoods);
+        if (j.contains("seed") && !j["seed"].is_null())
+        {
+            opts.has_seed = true;
+            opts.seed = j["seed"].get<uint64_t>();
+        }
+    }
+    catch (const json::exception &ex) // a key of the wrong type
+    {
+        throw invalid_argument(string("options.lns: ") + ex.what());
+    }
+    return opts;
+}
+
+InitialSolution improve_with_lns(const ProblemData &data, const InitialSolution &init,
+                                 const LnsOptions &opts, const SolveControl &ctl)
+{
+    const CompiledProblem &cp = data.compiled;
+    vector<PinnedStart> best;
+    if (init.assignments.empty() || !to_pinned(cp, init, best))
+    {
+        cout << "[LNS] Skipped: no complete initial schedule\n";
+        return init;
+    }
+
+    auto start = chrono::steady_clock::now();
+    auto deadline = start + chrono::duration_cast<chrono::steady_clock::duration>(
+                                chrono::duration<double>(opts.time_limit_seconds));
+    auto params_for = [&](double seconds, int worker)
+    {
+        SatParameters params;
+        params.set_max_time_in_seconds(seconds);
+        params.set_num_search_workers(max(1, opts.workers));
+        params.set_log_search_progress(false);
+        params.set_repair_hint(true);
+        if (opts.has_seed)
+            params.set_random_seed((int)(thread_seed(opts, worker) & 0x7fffffff));
+        return params;
+    };
+
+    // objective of the initial schedule, the same score the Phase 2 model maximizes
+    vector<Placement> placements = to_placements(cp, init.assignments);
+    if (!check_constraints(cp, placements, 1).empty())
+    {
+        cout << "[LNS] Skipped: initial schedule is not feasible for the Phase 2 model\n";
+        return init;
+    }
+    double best_objective = (double)evaluate_objective(cp, placements).total();
+    double initial_objective = best_objective;
+
+    mutex m;
+    atomic<int> next_neighborhood{0};
+    int tried[kNeighborhoods] = {0}, improved[kNeighborhoods] = {0};
+
+    auto worker = [&](int w)
+    {
+        mt19937 rng((mt19937::result_type)thread_seed(opts, w));
+        for (;;)
+        {
+            int n = next_neighborhood++;
+            if (ctl.cancelled() || (opts.max_neighborhoods > 0 && n >= opts.max_neighborhoods))
+                return;
+            double remaining = chrono::duration<double>(deadline - chrono::steady_clock::now()).count();
+            if (remaining <= 0)
+                return;
+
+            vector<PinnedStart> current;
+            double current_objective;
+            {
+                lock_guard<mutex> lock(m);
+                current = best;
+                current_objective = best_objective;
+            }
+            Neighborhood kind = (Neighborhood)(n % kNeighborhoods);
+            vector<char> freed = pick_neighborhood(cp, current, kind, max(1, opts.neighborhood_size), rng);
+
+            vector<PinnedStart> candidate;
+            double objective;
+            bool ok = solve_neighborhood(cp, current, freed,
+                                         params_for(min(opts.neighborhood_time_limit_seconds, remaining), w),
+                                         ctl, candidate, objective);
+
+            lock_guard<mutex> lock(m);
+            ++tried[(int)kind];
+            // another thread may have improved best meanwhile; the candidate is a complete schedule either way
+            if (!ok || objective <= best_objective + 1e-6)
+                continue;
+            ++improved[(int)kind];
+            best = std::move(candidate);
+            best_objective = objective;
+            cout << "[LNS] " << neighborhood_name(kind) << " improved " << current_objective << " -> " << objective << "\n";
+            if (ctl.on_incumbent)
+            {
+                IncumbentUpdate update;
+                update.phase = "lns";
+                update.objective_value = (long long)llround(objective);
+                update.elapsed_seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+                update.assignments = assignments_to_json(from_pinned(cp, best).assignments);
+                ctl.on_incumbent(update);
+            }
+        }
+    };
+
+    int threads = solver_threads(opts.threads);
+    vector<thread> pool;
+    for (int w = 0; w < threads; ++w)
+        pool.emplace_back(worker, w);
+    for (auto &t : pool)
+        t.join();
+
+    cout << "[LNS] Objective " << initial_objective << " -> " << best_objective << " in "
+         << chrono::duration<double>(chrono::steady_clock::now() - start).count() << "s;";
+    for (int k = 0; k < kNeighborhoods; ++k)
+        cout << " " << neighborhood_name((Neighborhood)k) << " " << improved[k] << "/" << tried[k];
+    cout << "\n";
+
+    return from_pinned(cp, best);
+}
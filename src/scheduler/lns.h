@@ -0,0 +1,30 @@
+#pragma once
+#include "phase1.h"
+#include "phase2.h"
+#include "solve_control.h"
+using namespace std;
+
+// Tham số cho giai đoạn LNS (giữa phase 2 và phase 3)
+struct LnsOptions {
+    bool enabled = false;
+    double time_limit_seconds = 10;             // wall-clock budget for the whole stage
+    double neighborhood_time_limit_seconds = 2; // CP-SAT cap per neighborhood
+    int threads = 1;             // neighborhoods solved in parallel, 0 = one per hardware thread
+    int workers = 1;             // CP-SAT workers per neighborhood
+    int neighborhood_size = 4;   // teachers in a teacher group, courses in a course cluster
+    int max_neighborhoods = 0;   // 0 = until the time limit
+    bool has_seed = false;
+    uint64_t seed = 0;
+};
+
+// Read LnsOptions from the "lns" object of a request, missing keys keep their defaults.
+// Throws invalid_argument when j is not an object or a key has the wrong type.
+LnsOptions lns_options_from_json(const json &j);
+
+// Large Neighborhood Search: repeatedly free one day, one group of teachers
+// sharing courses, or one cluster of courses sharing teachers, and re-solve
+// only that part with the Phase 2 CP-SAT model while the rest stays pinned.
+// Returns init unchanged when it is empty or not a complete feasible schedule.
+InitialSolution improve_with_lns(const ProblemData &data, const InitialSolution &init,
+                                 const LnsOptions &opts = LnsOptions(),
+                                 const SolveControl &ctl = SolveControl());
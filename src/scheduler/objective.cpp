@@ -0,0 +1,142 @@
+#include "objective.h"
+
+using namespace std;
+
+namespace
+{
+    int lookup(const unordered_map<string, int> &index, const string &id, const char *what)
+    {
+        auto it = index.find(id);
+        if (it == index.end())
+            throw runtime_error(string("unknown ") + what + " '" + id + "'");
+        return it->second;
+    }
+} // anonymous namespace
+
+vector<int> daily_section_targets(const CompiledProblem &cp)
+{
+    vector<int> target(cp.num_teachers, 0);
+    for (int i = 0; i < cp.num_teachers; ++i)
+    {
+        int total = 0;
+        for (int j = 0; j < cp.num_courses; ++j)
+            if (cp.eligible(i, j))
+                total += cp.sections_of(j);
+        target[i] = (total + cp.num_days - 1) / cp.num_days;
+    }
+    return target;
+}
+
+ObjectiveBreakdown evaluate_objective(const CompiledProblem &cp, const vector<Placement> &placements)
+{
+    ObjectiveBreakdown score;
+    vector<char> teaches((size_t)cp.num_teachers * cp.num_courses, 0);
+    vector<int> day_sections((size_t)cp.num_teachers * cp.num_days, 0);
+    for (const auto &p : placements)
+    {
+        score.time_preference += block_preference(cp, p.teacher, p.section, p.day, p.period);
+        char &t = teaches[(size_t)p.teacher * cp.num_courses + p.course];
+        if (!t)
+            score.course_preference += cp.pc(p.teacher, p.course);
+        t = 1;
+        ++day_sections[(size_t)p.teacher * cp.num_days + p.day];
+    }
+    vector<int> target = daily_section_targets(cp);
+    for (int i = 0; i < cp.num_teachers; ++i)
+        for (int l = 0; l < cp.num_days; ++l)
+            score.overload += max(0, day_sections[(size_t)i * cp.num_days + l] - target[i]);
+    return score;
+}
+
+vector<string> check_constraints(const CompiledProblem &cp, const vector<Placement> &placements, size_t max_messages)
+{
+    vector<string> out;
+    auto violation = [&](const string &msg)
+    {
+        if (out.size() < max_messages)
+            out.push_back(msg);
+    };
+
+    const int S = cp.num_slots();
+    vector<int> section_count(cp.num_sections, 0);
+    vector<int> slot_count(S, 0);
+    vector<int> teacher_slot((size_t)cp.num_teachers * S, 0);
+    vector<int> course_slot((size_t)cp.num_courses * S, 0);
+    vector<char> teaches((size_t)cp.num_teachers * cp.num_courses, 0);
+
+    for (const auto &p : placements)
+    {
+        ++section_count[p.section];
+        if (!cp.eligible(p.teacher, p.course))
+            violation("teacher " + cp.teacher_ids[p.teacher] + " is not eligible for course " + cp.course_ids[p.course]);
+        teaches[(size_t)p.teacher * cp.num_courses + p.course] = 1;
+        int r = cp.section_required_periods[p.section];
+        if (p.period + r > cp.num_periods)
+        {
+            violation("section " + cp.section_ids[p.section] + " runs past the last period of " + cp.days[p.day]);
+            continue;
+        }
+        for (int m = p.period; m < p.period + r; ++m)
+        {
+            int sk = cp.slot(p.day, m);
+            ++slot_count[sk];
+            ++teacher_slot[(size_t)p.teacher * S + sk];
+            ++course_slot[(size_t)p.course * S + sk];
+        }
+    }
+
+    for (int s = 0; s < cp.num_sections; ++s)
+        if (section_count[s] != 1)
+            violation("section " + cp.section_ids[s] + " of course " + cp.course_ids[cp.section_course[s]] +
+                      " is scheduled " + to_string(section_count[s]) + " times");
+
+    for (int i = 0; i < cp.num_teachers; ++i)
+    {
+        int courses = 0;
+        for (int j = 0; j < cp.num_courses; ++j)
+            courses += teaches[(size_t)i * cp.num_courses + j];
+        if (courses < 1 || courses > cp.teacher_max_courses[i])
+            violation("teacher " + cp.teacher_ids[i] + " teaches " + to_string(courses) + " courses (1.." +
+                      to_string(cp.teacher_max_courses[i]) + " allowed)");
+    }
+    for (int j = 0; j < cp.num_courses; ++j)
+    {
+        int teachers = 0;
+        for (int i = 0; i < cp.num_teachers; ++i)
+            teachers += teaches[(size_t)i * cp.num_courses + j];
+        if (teachers < cp.course_min_teachers[j] || teachers > cp.course_max_teachers[j])
+            violation("course " + cp.course_ids[j] + " has " + to_string(teachers) + " teachers (" +
+                      to_string(cp.course_min_teachers[j]) + ".." + to_string(cp.course_max_teachers[j]) + " allowed)");
+    }
+
+    for (int l = 0; l < cp.num_days; ++l)
+        for (int m = 0; m < cp.num_periods; ++m)
+        {
+            int sk = cp.slot(l, m);
+            string where = cp.days[l] + " " + cp.periods[m];
+            if (slot_count[sk] > cp.capacity[sk])
+                violation(to_string(slot_count[sk]) + " sections at " + where + ", " + to_string(cp.capacity[sk]) +
+                          " classrooms");
+            for (int i = 0; i < cp.num_teachers; ++i)
+                if (teacher_slot[(size_t)i * S + sk] > 1)
+                    violation("teacher " + cp.teacher_ids[i] + " has overlapping sections at " + where);
+            for (int j = 0; j < cp.num_courses; ++j)
+                if (course_slot[(size_t)j * S + sk] > 1)
+                    violation("course " + cp.course_ids[j] + " has overlapping sections at " + where);
+        }
+    return out;
+}
+
+Placement to_placement(const CompiledProblem &cp, const string &teacher_id, const string &course_id,
+                       const string &section_id, const string &day, const string &period)
+{
+    Placement p;
+    p.teacher = lookup(cp.teacher_index, teacher_id, "teacher");
+    p.course = lookup(cp.course_index, course_id, "course");
+    p.section = cp.section_index(p.course, section_id);
+    if (p.section < 0)
+        throw runtime_error("unknown section '" + section_id + "' of course '" + course_id + "'");
+    p.day = lookup(cp.day_index, day, "day");
+    p.period = lookup(cp.period_index, period, "period");
+    return p;
+}
@@ -0,0 +1,64 @@
+#pragma once
+// Objective and hard constraints of the timetable in index form, shared by
+// the Phase 2 model and the Phase 3 search so both optimize the same score.
+#include "phase1.h"
+#include <stdexcept>
+#include <string>
+#include <vector>
+using namespace std;
+
+// One scheduled section (see CompiledProblem); section is global, period is the start period
+struct Placement {
+    int teacher;
+    int course;
+    int section;
+    int day;
+    int period;
+};
+
+// Objective = course_preference + time_preference - overload
+//   course_preference: PC[i][j] once per teacher i teaching course j
+//   time_preference:   PT[i][l][m] over every period a section covers
+//   overload:          per teacher and day, sections above daily_section_targets()
+struct ObjectiveBreakdown {
+    long long course_preference = 0;
+    long long time_preference = 0;
+    long long overload = 0;
+    long long total() const { return course_preference + time_preference - overload; }
+};
+
+// PT of teacher i summed over the periods of section s started at (day, start)
+inline int block_preference(const CompiledProblem &cp, int teacher, int section, int day, int start)
+{
+    int score = 0;
+    for (int m = start; m < start + cp.section_required_periods[section]; ++m)
+        score += cp.pt(teacher, day, m);
+    return score;
+}
+
+// Per teacher: sections a day may hold before it counts as overloaded, the
+// even spread ceil(sections of all eligible courses / days)
+vector<int> daily_section_targets(const CompiledProblem &cp);
+
+ObjectiveBreakdown evaluate_objective(const CompiledProblem &cp, const vector<Placement> &placements);
+
+// Phase 2 constraints 1-6 (every section once, eligibility, teacher and course
+// bounds, capacity, no teacher or course overlap). Returns a description of
+// each violation, at most max_messages of them; empty when feasible.
+vector<string> check_constraints(const CompiledProblem &cp, const vector<Placement> &placements,
+                                 size_t max_messages = 20);
+
+// Index form of one assignment given by ids; throws on unknown ids
+Placement to_placement(const CompiledProblem &cp, const string &teacher_id, const string &course_id,
+                       const string &section_id, const string &day, const string &period);
+
+// Index form of a list of assignments (InitialSolution or OptimalSolution)
+template <class Assignments>
+vector<Placement> to_placements(const CompiledProblem &cp, const Assignments &list)
+{
+    vector<Placement> out;
+    out.reserve(list.size());
+    for (const auto &a : list)
+        out.push_back(to_placement(cp, a.teacher_id, a.course_id, a.section_id, a.day, a.period));
+    return out;
+}
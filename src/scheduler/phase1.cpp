@@ -1,6 +1,7 @@
 #include "phase1.h"
 #include <algorithm>
 #include <iostream>
+#include <tuple>
 
 using namespace std;
 
@@ -55,6 +56,227 @@ static void fill_course_from_json(Course &course, const json &jc)
     }
 }
 
+namespace
+{
+    // Two FNV-1a style lanes with different bases and mixing; length-prefixed
+    // strings keep field boundaries unambiguous
+    class CanonicalHasher
+    {
+    public:
+        void add(long long v)
+        {
+            for (int k = 0; k < 8; ++k)
+                byte((unsigned char)(v >> (8 * k)));
+        }
+        void add(const string &str)
+        {
+            add((long long)str.size());
+            for (unsigned char c : str)
+                byte(c);
+        }
+        string hex() const
+        {
+            return hex_word(a_) + hex_word(b_);
+        }
+
+    private:
+        void byte(unsigned char c)
+        {
+            a_ = (a_ ^ c) * 0x100000001b3ULL;
+            b_ = ((b_ ^ c) * 0x9e3779b97f4a7c15ULL);
+            b_ ^= b_ >> 29;
+        }
+        static string hex_word(uint64_t w)
+        {
+            static const char *digits = "0123456789abcdef";
+            string out(16, '0');
+            for (int k = 15; k >= 0; --k, w >>= 4)
+                out[k] = digits[w & 15];
+            return out;
+        }
+
+        uint64_t a_ = 0xcbf29ce484222325ULL;
+        uint64_t b_ = 0x84222325cbf29ce4ULL;
+    };
+} // anonymous namespace
+
+string problem_hash(const ProblemData &data, const json &extra)
+{
+    CanonicalHasher h;
+
+    vector<const Teacher *> teachers;
+    for (const auto &t : data.teachers)
+        teachers.push_back(&t);
+    sort(teachers.begin(), teachers.end(), [](const Teacher *a, const Teacher *b)
+         { return a->id < b->id; });
+    h.add((long long)teachers.size());
+    for (const Teacher *t : teachers)
+    {
+        h.add(t->id);
+        h.add(t->max_courses);
+        vector<string> eligible = t->eligible_courses;
+        sort(eligible.begin(), eligible.end());
+        h.add((long long)eligible.size());
+        for (const auto &c : eligible)
+            h.add(c);
+        h.add((long long)t->course_pref.size());
+        for (const auto &cp : t->course_pref) // map: already sorted
+        {
+            h.add(cp.first);
+            h.add(cp.second);
+        }
+        vector<TimePref> prefs = t->time_pref;
+        sort(prefs.begin(), prefs.end(), [](const TimePref &a, const TimePref &b)
+             { return tie(a.day, a.period, a.score) < tie(b.day, b.period, b.score); });
+        h.add((long long)prefs.size());
+        for (const auto &tp : prefs)
+        {
+            h.add(tp.day);
+            h.add(tp.period);
+            h.add(tp.score);
+        }
+    }
+
+    vector<const Course *> courses;
+    for (const auto &c : data.courses)
+        courses.push_back(&c);
+    sort(courses.begin(), courses.end(), [](const Course *a, const Course *b)
+         { return a->id < b->id; });
+    h.add((long long)courses.size());
+    for (const Course *c : courses)
+    {
+        h.add(c->id);
+        h.add(c->min_teachers);
+        h.add(c->max_teachers);
+        vector<Section> sections = c->sections;
+        sort(sections.begin(), sections.end(), [](const Section &a, const Section &b)
+             { return a.id < b.id; });
+        h.add((long long)sections.size());
+        for (const auto &sec : sections)
+        {
+            h.add(sec.id);
+            h.add(sec.required_periods);
+        }
+    }
+
+    // day and period order is meaningful (blocks span consecutive periods)
+    h.add((long long)data.classrooms.days.size());
+    for (const auto &d : data.classrooms.days)
+        h.add(d);
+    h.add((long long)data.classrooms.periods.size());
+    for (const auto &p : data.classrooms.periods)
+        h.add(p);
+    for (const auto &day : data.classrooms.Clm)
+        for (const auto &period : day.second)
+        {
+            h.add(day.first);
+            h.add(period.first);
+            h.add(period.second);
+        }
+
+    h.add(extra.dump());
+    return h.hex();
+}
+
+CompiledProblem compile_problem(const ProblemData &data)
+{
+    CompiledProblem cp;
+    cp.num_teachers = (int)data.teachers.size();
+    cp.num_courses = (int)data.courses.size();
+    cp.num_days = (int)data.classrooms.days.size();
+    cp.num_periods = (int)data.classrooms.periods.size();
+    const int I = cp.num_teachers, J = cp.num_courses, L = cp.num_days, M = cp.num_periods;
+
+    cp.days = data.classrooms.days;
+    cp.periods = data.classrooms.periods;
+    for (int l = 0; l < L; ++l)
+        cp.day_index[cp.days[l]] = l;
+    for (int m = 0; m < M; ++m)
+        cp.period_index[cp.periods[m]] = m;
+
+    // Teachers
+    cp.teacher_ids.reserve(I);
+    cp.teacher_max_courses.reserve(I);
+    for (int i = 0; i < I; ++i)
+    {
+        cp.teacher_ids.push_back(data.teachers[i].id);
+        cp.teacher_index[data.teachers[i].id] = i;
+        cp.teacher_max_courses.push_back(data.teachers[i].max_courses);
+    }
+
+    // Courses and sections
+    cp.course_section_begin.reserve(J + 1);
+    cp.course_section_begin.push_back(0);
+    for (int j = 0; j < J; ++j)
+    {
+        const Course &c = data.courses[j];
+        cp.course_ids.push_back(c.id);
+        cp.course_index[c.id] = j;
+        cp.course_min_teachers.push_back(c.min_teachers);
+        cp.course_max_teachers.push_back(c.max_teachers);
+        for (const auto &sec : c.sections)
+        {
+            cp.section_ids.push_back(sec.id);
+            cp.section_course.push_back(j);
+            cp.section_required_periods.push_back(sec.required_periods);
+        }
+        cp.course_section_begin.push_back((int)cp.section_ids.size());
+    }
+    cp.num_sections = (int)cp.section_ids.size();
+
+    // Preferences and eligibility
+    cp.time_pref.assign((size_t)I * L * M, 0);
+    cp.course_pref.assign((size_t)I * J, 0);
+    cp.eligible_words = (J + 63) / 64;
+    cp.eligible_bits.assign((size_t)I * cp.eligible_words, 0);
+    for (int i = 0; i < I; ++i)
+    {
+        const Teacher &t = data.teachers[i];
+        for (const auto &tp : t.time_pref)
+        {
+            auto dit = cp.day_index.find(tp.day);
+            auto pit = cp.period_index.find(tp.period);
+            if (dit != cp.day_index.end() && pit != cp.period_index.end())
+                cp.time_pref[(i * L + dit->second) * M + pit->second] = tp.score;
+        }
+        for (const auto &cpref : t.course_pref)
+        {
+            auto cit = cp.course_index.find(cpref.first);
+            if (cit != cp.course_index.end())
+                cp.course_pref[i * J + cit->second] = cpref.second;
+        }
+        for (const auto &cid : t.eligible_courses)
+        {
+            auto cit = cp.course_index.find(cid);
+            if (cit != cp.course_index.end())
+                cp.eligible_bits[i * cp.eligible_words + (cit->second >> 6)] |= uint64_t(1) << (cit->second & 63);
+        }
+    }
+
+    // Eligible teachers per course, same order as Course::Ij
+    cp.course_eligible_teachers.resize(J);
+    for (int j = 0; j < J; ++j)
+        for (const auto &tid : data.courses[j].Ij)
+            cp.course_eligible_teachers[j].push_back(cp.teacher_index.at(tid));
+
+    // Classroom capacity per slot
+    cp.capacity.assign((size_t)L * M, 0);
+    for (int l = 0; l < L; ++l)
+    {
+        auto day_it = data.classrooms.Clm.find(cp.days[l]);
+        if (day_it == data.classrooms.Clm.end())
+            continue;
+        for (int m = 0; m < M; ++m)
+        {
+            auto period_it = day_it->second.find(cp.periods[m]);
+            if (period_it != day_it->second.end())
+                cp.capacity[l * M + m] = period_it->second;
+        }
+    }
+
+    return cp;
+}
+
 ProblemData initialize_problem_from_json(const json &j_input)
 {
     ProblemData data;
@@ -111,6 +333,8 @@ ProblemData initialize_problem_from_json(const json &j_input)
             course.Ij.push_back(p.first);
     }
 
+    data.compiled = compile_problem(data);
+
     cout << "✅ Phase1 built from JSON: "
          << data.teachers.size() << " teachers, "
          << data.courses.size() << " courses, "
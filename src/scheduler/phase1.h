@@ -4,6 +4,8 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_map>
+#include <cstdint>
 
 using json = nlohmann::json;
 using namespace std;
@@ -49,11 +51,86 @@ struct ClassroomInfo
     map<string, map<string, int>> Clm;
 };
 
+// Dense, index-based form of ProblemData shared by Phase 2 and Phase 3.
+// Teachers (i), courses (j), days (l) and periods (m) keep their position in
+// ProblemData; sections get a global index s in [0, num_sections).
+struct CompiledProblem
+{
+    int num_teachers = 0;
+    int num_courses = 0;
+    int num_sections = 0;
+    int num_days = 0;
+    int num_periods = 0;
+
+    // id tables (index -> string id), used to build solution output
+    vector<string> teacher_ids;
+    vector<string> course_ids;
+    vector<string> section_ids; // by global section index
+    vector<string> days;
+    vector<string> periods;
+
+    // id -> index
+    unordered_map<string, int> teacher_index;
+    unordered_map<string, int> course_index;
+    unordered_map<string, int> day_index;
+    unordered_map<string, int> period_index;
+
+    // course j owns global sections [course_section_begin[j], course_section_begin[j + 1])
+    vector<int> course_section_begin;
+    vector<int> section_course;
+    vector<int> section_required_periods;
+
+    vector<int> teacher_max_courses;
+    vector<int> course_min_teachers;
+    vector<int> course_max_teachers;
+
+    // index form of Course::Ij (eligible teachers sorted by course preference)
+    vector<vector<int>> course_eligible_teachers;
+
+    // flat matrices
+    vector<int> time_pref;   // PT[i][l][m] at (i * num_days + l) * num_periods + m
+    vector<int> course_pref; // PC[i][j] at i * num_courses + j
+    vector<int> capacity;    // Clm at l * num_periods + m, 0 when the slot is missing
+
+    // eligibility bitset: teacher i owns words [i * eligible_words, (i + 1) * eligible_words)
+    int eligible_words = 0;
+    vector<uint64_t> eligible_bits;
+
+    int num_slots() const { return num_days * num_periods; }
+    int slot(int l, int m) const { return l * num_periods + m; }
+    int pt(int i, int l, int m) const { return time_pref[(i * num_days + l) * num_periods + m]; }
+    int pc(int i, int j) const { return course_pref[i * num_courses + j]; }
+    int cap(int l, int m) const { return capacity[l * num_periods + m]; }
+    bool eligible(int i, int j) const
+    {
+        return (eligible_bits[i * eligible_words + (j >> 6)] >> (j & 63)) & 1u;
+    }
+    int sections_of(int j) const { return course_section_begin[j + 1] - course_section_begin[j]; }
+
+    // global section index of section_id in course j, -1 if absent
+    int section_index(int j, const string &section_id) const
+    {
+        for (int s = course_section_begin[j]; s < course_section_begin[j + 1]; ++s)
+            if (section_ids[s] == section_id)
+                return s;
+        return -1;
+    }
+};
+
 struct ProblemData
 {
     vector<Teacher> teachers;
     vector<Course> courses;
     ClassroomInfo classrooms;
+    CompiledProblem compiled;
 };
 
 ProblemData initialize_problem_from_json(const json &j_input);
+
+// Build the index-based form from the string-based fields of data
+CompiledProblem compile_problem(const ProblemData &data);
+
+// 128-bit hex hash of everything in data that affects solving, independent of
+// JSON key order, whitespace, names and the order of teachers, courses and
+// sections. extra (e.g. solver options) is mixed in through its sorted dump.
+string problem_hash(const ProblemData &data, const json &extra = json());
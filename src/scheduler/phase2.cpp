@@ -1,12 +1,19 @@
 #include "phase2.h"
+#include "phase2_model.h"
 #include "ortools/sat/cp_model.h"
 #include "ortools/sat/cp_model_solver.h"
+#include "ortools/sat/sat_parameters.pb.h"
+#include "ortools/util/time_limit.h"
 #include <iostream>
 #include <map>
-#include <tuple>
-#include <unordered_map>
+#include <stdexcept>
 #include <vector>
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <atomic>
+#include <functional>
+#include <thread>
 
 using namespace operations_research;
 using namespace operations_research::sat;
@@ -31,362 +38,515 @@ void print_initial_solution(const InitialSolution &sol)
     }
 }
 
-InitialSolution construct_initial_solution(const ProblemData &data)
+Phase2Options phase2_options_from_json(const json &j)
 {
-    CpModelBuilder model;
-
-    // ---------- indices and sizes ----------
-    int I = (int)data.teachers.size();
-    int J = (int)data.courses.size();
-    int L = (int)data.classrooms.days.size();
-    int M = (int)data.classrooms.periods.size();
-
-    // sections per course
-    vector<int> S;
-    S.reserve(J);
-    for (int j = 0; j < J; ++j)
-        S.push_back((int)data.courses[j].sections.size());
-
-    // maps id -> index (useful for building outputs)
-    unordered_map<string, int> teacher_idx;
-    unordered_map<string, int> course_idx;
-    for (int i = 0; i < I; ++i)
-        teacher_idx[data.teachers[i].id] = i;
-    for (int j = 0; j < J; ++j)
-        course_idx[data.courses[j].id] = j;
-
-    // Build teacher time preference lookup: PT[i][l][m]
-    vector<vector<vector<int>>> PT(I, vector<vector<int>>(L, vector<int>(M, 0)));
-    for (int i = 0; i < I; ++i)
+    if (!j.is_object())
+        throw invalid_argument("options.phase2 must be an object");
+    Phase2Options opts;
+    try
     {
-        for (const auto &tp : data.teachers[i].time_pref)
+        string profile = j.value("profile", string("default"));
+        if (profile == "fast_feasible")
         {
-            int li = -1, mi = -1;
-            for (int l = 0; l < L; ++l)
-                if (data.classrooms.days[l] == tp.day)
-                {
-                    li = l;
-                    break;
-                }
-            for (int m = 0; m < M; ++m)
-                if (data.classrooms.periods[m] == tp.period)
-                {
-                    mi = m;
-                    break;
-                }
-            if (li >= 0 && mi >= 0)
-                PT[i][li][mi] = tp.score;
+            opts.stop_after_first_solution = true;
+            opts.time_limit_seconds = 10;
         }
+        else if (profile != "default")
+            throw invalid_argument("unknown phase2 profile: " + profile);
+
+        opts.time_limit_seconds = j.value("time_limit_seconds", opts.time_limit_seconds);
+        opts.workers = j.value("workers", opts.workers);
+        opts.relative_gap_limit = j.value("relative_gap_limit", opts.relative_gap_limit);
+        opts.stop_after_first_solution = j.value("stop_after_first_solution", opts.stop_after_first_solution);
+        if (j.contains("seed") && !j["seed"].is_null())
+        {
+            opts.has_seed = true;
+            opts.seed = j["seed"].get<int>();
+        }
+        opts.fix_unchanged = j.value("fix_unchanged", opts.fix_unchanged);
+        opts.debug_names = j.value("debug_names", opts.debug_names);
+        opts.symmetry_breaking = j.value("symmetry_breaking", opts.symmetry_breaking);
+        opts.decompose = j.value("decompose", opts.decompose);
+        opts.decompose_threads = j.value("decompose_threads", opts.decompose_threads);
     }
+    catch (const json::exception &ex) // a key of the wrong type
+    {
+        throw invalid_argument(string("options.phase2: ") + ex.what());
+    }
+    return opts;
+}
 
-    // Course preference PC[i][j]
-    vector<vector<int>> PC(I, vector<int>(J, 0));
-    for (int i = 0; i < I; ++i)
+vector<InitialSolution::Assignment> assignments_from_json(const json &arr)
+{
+    if (!arr.is_array())
+        throw runtime_error("assignments must be an array");
+    vector<InitialSolution::Assignment> out;
+    out.reserve(arr.size());
+    for (const auto &ja : arr)
     {
-        for (int j = 0; j < J; ++j)
-        {
-            const auto &cid = data.courses[j].id;
-            if (data.teachers[i].course_pref.count(cid))
-                PC[i][j] = data.teachers[i].course_pref.at(cid);
-        }
+        InitialSolution::Assignment a;
+        a.teacher_id = ja.at("teacher_id").get<string>();
+        a.course_id = ja.at("course_id").get<string>();
+        a.section_id = ja.at("section_id").get<string>();
+        a.day = ja.at("day").get<string>();
+        a.period = ja.at("period").get<string>();
+        out.push_back(a);
     }
+    return out;
+}
 
-    // Helper: teacher eligible table
-    vector<vector<bool>> eligible(I, vector<bool>(J, false));
-    for (int i = 0; i < I; ++i)
+namespace
+{
+    int find_index(const unordered_map<string, int> &index, const string &id)
     {
-        for (int j = 0; j < J; ++j)
-        {
-            if (find(data.teachers[i].eligible_courses.begin(), data.teachers[i].eligible_courses.end(),
-                     data.courses[j].id) != data.teachers[i].eligible_courses.end())
-            {
-                eligible[i][j] = true;
-            }
-        }
+        auto it = index.find(id);
+        return it == index.end() ? -1 : it->second;
     }
 
-    // ---------- Variables ----------
-    // Y(i,j,k,l,m0) : teacher i starts section k of course j at day l, starting period m0
-    // We'll store in map keyed by tuple(i,j,k,l,m0)
-    using Key = tuple<int, int, int, int, int>;
-    map<Key, BoolVar> Y;
+    // The ordering of interchangeable sections would contradict a warm start
+    // that placed them in another order, so hints and fixes turn it off
+    bool break_symmetry(const Phase2Options &opts)
+    {
+        return opts.symmetry_breaking && opts.warm_start.empty();
+    }
 
-    for (int i = 0; i < I; ++i)
+    // ---------- Warm start ----------
+    // Every previous assignment that still maps onto a Y variable of pm becomes
+    // a hint. Sections covered by the previous schedule get a complete hint
+    // (1 on the old start, 0 elsewhere) so CP-SAT can accept it right away.
+    // Returns how many assignments were fixed (opts.fix_unchanged), within capacity.
+    int add_warm_start(const CompiledProblem &cp, Phase2Model &pm, const Phase2Options &opts, const vector<int> &capacity)
     {
-        for (int j = 0; j < J; ++j)
+        if (opts.warm_start.empty())
+            return 0;
+        int fixed_count = 0;
+        const int I = cp.num_teachers;
+        const int J = cp.num_courses;
+        const int L = cp.num_days;
+        const int M = cp.num_periods;
+
+        vector<int> hinted_var(cp.num_sections, -1); // global section -> y id of its previous start
+        for (const auto &a : opts.warm_start)
         {
-            if (!eligible[i][j])
+            int i = find_index(cp.teacher_index, a.teacher_id);
+            int j = find_index(cp.course_index, a.course_id);
+            int l = find_index(cp.day_index, a.day);
+            int m0 = find_index(cp.period_index, a.period);
+            if (i < 0 || j < 0 || l < 0 || m0 < 0)
+                continue;
+            int s = cp.section_index(j, a.section_id);
+            if (s < 0 || hinted_var[s] >= 0)
                 continue;
-            for (int k = 0; k < S[j]; ++k)
+            // -1 when the teacher is no longer eligible or the block overflows the day
+            hinted_var[s] = pm.find_start(i, s, l, m0);
+        }
+
+        // fix_unchanged: keep the hinted assignments that are still jointly
+        // feasible; later ones that clash with an earlier one are only hinted
+        vector<char> fixed(pm.y.size(), 0);
+        if (opts.fix_unchanged)
+        {
+            vector<int> slot_used(cp.num_slots(), 0);
+            vector<char> teacher_busy((size_t)I * L * M, 0);
+            vector<char> course_busy((size_t)J * L * M, 0);
+            vector<int> teacher_courses(I, 0);
+            vector<int> course_teachers(J, 0);
+            vector<char> pair_used(pm.p.size(), 0);
+            for (int s = 0; s < cp.num_sections; ++s)
             {
-                int r = data.courses[j].sections[k].required_periods;
-                for (int l = 0; l < L; ++l)
+                if (hinted_var[s] < 0)
+                    continue;
+                const StartVar &sv = pm.y[hinted_var[s]];
+                int i = sv.teacher, j = sv.course, l = sv.day;
+                int r = cp.section_required_periods[s];
+                int q = pm.pair_of[(size_t)i * J + j];
+                bool ok = true;
+                for (int m = sv.start; m < sv.start + r && ok; ++m)
+                    ok = slot_used[cp.slot(l, m)] < capacity[cp.slot(l, m)] &&
+                         !teacher_busy[((size_t)i * L + l) * M + m] &&
+                         !course_busy[((size_t)j * L + l) * M + m];
+                if (ok && !pair_used[q])
+                    ok = teacher_courses[i] < cp.teacher_max_courses[i] &&
+                         course_teachers[j] < cp.course_max_teachers[j];
+                if (!ok)
+                    continue;
+                for (int m = sv.start; m < sv.start + r; ++m)
+                {
+                    ++slot_used[cp.slot(l, m)];
+                    teacher_busy[((size_t)i * L + l) * M + m] = 1;
+                    course_busy[((size_t)j * L + l) * M + m] = 1;
+                }
+                if (!pair_used[q])
                 {
-                    for (int m0 = 0; m0 < M; ++m0)
-                    {
-                        if (m0 + r - 1 < M)
-                        {
-                            string name = string("Y_t") + to_string(i) + "_c" + to_string(j) + "_s" + to_string(k) + "_d" + to_string(l) + "_m" + to_string(m0);
-                            Y[Key(i, j, k, l, m0)] = model.NewBoolVar().WithName(name);
-                            ;
-                        }
-                        // else m0 invalid start -> no var created
-                    }
+                    pair_used[q] = 1;
+                    ++teacher_courses[i];
+                    ++course_teachers[j];
                 }
+                fixed[hinted_var[s]] = 1;
             }
         }
-    }
 
-    // P(i,j) : teacher i teaches course j (binary), create only for eligible combos
-    map<pair<int, int>, BoolVar> P;
-    for (int i = 0; i < I; ++i)
-        for (int j = 0; j < J; ++j)
-            if (eligible[i][j])
+        vector<char> pair_hinted(pm.p.size(), 0);
+        int hinted_count = 0;
+        for (int s = 0; s < cp.num_sections; ++s)
+        {
+            if (hinted_var[s] < 0)
+                continue;
+            ++hinted_count;
+            for (int v : pm.by_section[s])
+                pm.builder.AddHint(pm.y[v].var, v == hinted_var[s]);
+            const StartVar &sv = pm.y[hinted_var[s]];
+            pair_hinted[pm.pair_of[(size_t)sv.teacher * J + sv.course]] = 1;
+            if (fixed[hinted_var[s]])
             {
-                string name = "P_t" + to_string(i) + "_c" + to_string(j);
-                P[{i, j}] = model.NewBoolVar().WithName(name);
+                pm.builder.AddEquality(sv.var, 1);
+                ++fixed_count;
             }
+        }
+        for (size_t q = 0; q < pm.p.size(); ++q)
+        {
+            int j = pm.p_key[q].second;
+            bool all_hinted = true;
+            for (int s = cp.course_section_begin[j]; s < cp.course_section_begin[j + 1] && all_hinted; ++s)
+                all_hinted = hinted_var[s] >= 0;
+            if (pair_hinted[q])
+                pm.builder.AddHint(pm.p[q], true);
+            else if (all_hinted)
+                pm.builder.AddHint(pm.p[q], false);
+        }
+        cout << "Phase2 warm start: " << hinted_count << "/" << opts.warm_start.size()
+             << " previous assignments hinted, " << fixed_count << " fixed\n";
+        return fixed_count;
+    }
 
-    // ---------- Constraints ----------
+    SatParameters sat_parameters(const Phase2Options &opts, int workers)
+    {
+        SatParameters params;
+        params.set_max_time_in_seconds(opts.time_limit_seconds);
+        params.set_num_search_workers(max(1, workers));
+        params.set_log_search_progress(false);
+        if (opts.relative_gap_limit > 0)
+            params.set_relative_gap_limit(opts.relative_gap_limit);
+        if (opts.has_seed)
+            params.set_random_seed(opts.seed);
+        params.set_stop_after_first_solution(opts.stop_after_first_solution);
+        // let CP-SAT patch a warm start hint that is slightly infeasible for the new problem
+        if (!opts.warm_start.empty())
+            params.set_repair_hint(true);
+        return params;
+    }
 
-    // 1) Each section must be scheduled exactly once (one teacher, one day, one start)
-    for (int j = 0; j < J; ++j)
+    // ---------- Decomposition ----------
+    // Connected components of the teacher-course eligibility graph. They only
+    // interact through classroom capacity, and the objective is a sum over
+    // teachers, so each can be solved as its own model.
+    vector<ModelScope> eligibility_components(const CompiledProblem &cp)
     {
-        for (int k = 0; k < S[j]; ++k)
+        const int I = cp.num_teachers;
+        const int J = cp.num_courses;
+
+        // union-find over teachers [0, I) and courses [I, I + J)
+        vector<int> parent(I + J);
+        for (int v = 0; v < I + J; ++v)
+            parent[v] = v;
+        auto find = [&](int v)
         {
-            LinearExpr sumStarts;
-            for (int i = 0; i < I; ++i)
+            while (parent[v] != v)
+                v = parent[v] = parent[parent[v]];
+            return v;
+        };
+        for (int i = 0; i < I; ++i)
+            for (int j = 0; j < J; ++j)
+                if (cp.eligible(i, j))
+                    parent[find(i)] = find(I + j);
+
+        vector<int> component_of(I + J, -1);
+        vector<ModelScope> components;
+        for (int v = 0; v < I + J; ++v)
+        {
+            int root = find(v);
+            if (component_of[root] < 0)
             {
-                if (!eligible[i][j])
-                    continue;
-                for (int l = 0; l < L; ++l)
-                    for (int m0 = 0; m0 < M; ++m0)
-                    {
-                        auto it = Y.find({i, j, k, l, m0});
-                        if (it != Y.end())
-                            sumStarts += it->second;
-                    }
+                component_of[root] = (int)components.size();
+                components.emplace_back();
             }
-            model.AddEquality(sumStarts, 1);
+            ModelScope &c = components[component_of[root]];
+            if (v < I)
+                c.teachers.push_back(v);
+            else
+                c.courses.push_back(v - I);
         }
-    }
 
-    // 2) Link P and Y: if any Y(i,j,k,.,.) = 1 => P(i,j) = 1, and if P=1 then sumY >= 1
-    for (int i = 0; i < I; ++i)
-        for (int j = 0; j < J; ++j)
-            if (eligible[i][j])
-            {
-                LinearExpr sumY_ij;
-                for (int k = 0; k < S[j]; ++k)
-                    for (int l = 0; l < L; ++l)
-                        for (int m0 = 0; m0 < M; ++m0)
-                        {
-                            auto it = Y.find({i, j, k, l, m0});
-                            if (it != Y.end())
-                                sumY_ij += it->second;
-                        }
-                // sumY_ij <= S[j] * P[i,j]
-                model.AddLessOrEqual(sumY_ij, LinearExpr(P[{i, j}]) * S[j]);
-                // sumY_ij >= P[i,j]
-                model.AddGreaterOrEqual(sumY_ij, P[{i, j}]);
-            }
+        // a teacher without courses or a course without teachers makes the
+        // problem infeasible anyway; let the whole model report it
+        for (const auto &c : components)
+            if (c.teachers.empty() || c.courses.empty())
+                return {ModelScope()};
 
-    // 3) Teacher max/min courses: sum_j P[i,j] <= max_courses, each teacher must teach >=1
-    for (int i = 0; i < I; ++i)
-    {
-        LinearExpr sumP;
-        for (int j = 0; j < J; ++j)
-            if (eligible[i][j])
-                sumP += P[{i, j}];
-        model.AddGreaterOrEqual(sumP, 1);
-        model.AddLessOrEqual(sumP, data.teachers[i].max_courses);
+        // biggest first, so they start early on the worker threads
+        sort(components.begin(), components.end(), [](const ModelScope &a, const ModelScope &b)
+             { return a.teachers.size() + a.courses.size() > b.teachers.size() + b.courses.size(); });
+        return components;
     }
 
-    // 4) Each course must be taught by at least min_teachers, at most max_teachers
-    for (int j = 0; j < J; ++j)
+    // Split every slot's classrooms between the components in proportion to
+    // the periods each one has to schedule (largest remainder rounding)
+    void split_capacity(const CompiledProblem &cp, vector<ModelScope> &components)
     {
-        LinearExpr sum_teachers = 0;
-        for (int i = 0; i < I; ++i)
+        const int C = (int)components.size();
+        vector<long long> demand(C, 0);
+        long long total = 0;
+        for (int c = 0; c < C; ++c)
         {
-            if (eligible[i][j])
-                sum_teachers += P[{i, j}];
+            for (int j : components[c].courses)
+                for (int s = cp.course_section_begin[j]; s < cp.course_section_begin[j + 1]; ++s)
+                    demand[c] += cp.section_required_periods[s];
+            total += demand[c];
         }
-        model.AddGreaterOrEqual(sum_teachers, data.courses[j].min_teachers);
-        model.AddLessOrEqual(sum_teachers, data.courses[j].max_teachers);
-    }
+        for (auto &c : components)
+            c.capacity.assign(cp.num_slots(), 0);
+        if (total == 0)
+            return;
 
-    // 5) Classroom capacity & teacher single-slot & course-per-time constraints:
-    // For every (l,m) we compute occupancy by summing Y that cover (l,m)
-    for (int l = 0; l < L; ++l)
-        for (int m = 0; m < M; ++m)
+        vector<int> order(C);
+        for (int slot = 0; slot < cp.num_slots(); ++slot)
         {
-            LinearExpr total_in_slot = 0;
-            // For course-per-slot restriction: for each course j ensure at most 1 section of this course in (l,m)
-            vector<LinearExpr> per_course_sum(J);
-            for (int j = 0; j < J; ++j)
-                per_course_sum[j] = LinearExpr(0);
-
-            for (int i = 0; i < I; ++i)
+            long long cap = cp.capacity[slot];
+            int given = 0;
+            for (int c = 0; c < C; ++c)
             {
-                for (int j = 0; j < J; ++j)
-                {
-                    if (!eligible[i][j])
-                        continue;
-                    for (int k = 0; k < S[j]; ++k)
-                    {
-                        int r = data.courses[j].sections[k].required_periods;
-                        // any start m0 that covers m: m0 <= m <= m0 + r - 1
-                        for (int m0 = max(0, m - r + 1); m0 <= m; ++m0)
-                        {
-                            auto it = Y.find({i, j, k, l, m0});
-                            if (it != Y.end())
-                            {
-                                total_in_slot += it->second;
-                                per_course_sum[j] += it->second;
-                                // We will also need teacher-per-slot; accumulate separately after this loop
-                            }
-                        }
-                    }
-                }
-            }
-            // classroom capacity
-            int cap = data.classrooms.Clm.at(data.classrooms.days[l]).at(data.classrooms.periods[m]);
-            model.AddLessOrEqual(total_in_slot, cap);
-
-            // per course per slot <= 1
-            for (int j = 0; j < J; ++j)
-            {
-                model.AddLessOrEqual(per_course_sum[j], 1);
+                components[c].capacity[slot] = (int)(cap * demand[c] / total);
+                given += components[c].capacity[slot];
+                order[c] = c;
             }
+            sort(order.begin(), order.end(), [&](int a, int b)
+                 { return cap * demand[a] % total > cap * demand[b] % total; });
+            for (int k = 0; given < cap && k < C; ++k, ++given)
+                ++components[order[k]].capacity[slot];
         }
+    }
 
-    // 6) Each teacher at most 1 section per time slot (enforce by summing Y that cover slot for that teacher)
-    for (int i = 0; i < I; ++i)
+    double seconds_since(chrono::steady_clock::time_point t)
     {
-        for (int l = 0; l < L; ++l)
-            for (int m = 0; m < M; ++m)
-            {
-                LinearExpr teacher_slot = 0;
-                for (int j = 0; j < J; ++j)
-                {
-                    if (!eligible[i][j])
-                        continue;
-                    for (int k = 0; k < S[j]; ++k)
-                    {
-                        int r = data.courses[j].sections[k].required_periods;
-                        for (int m0 = max(0, m - r + 1); m0 <= m; ++m0)
-                        {
-                            auto it = Y.find({i, j, k, l, m0});
-                            if (it != Y.end())
-                                teacher_slot += it->second;
-                        }
-                    }
-                }
-                model.AddLessOrEqual(teacher_slot, 1);
-            }
+        return chrono::duration<double>(chrono::steady_clock::now() - t).count();
     }
 
-    // 7) Each teacher schedule should be spread evenly over days (add penalty when overloaded)
+    void record_solve(const SolveControl &ctl, double build_seconds, double solve_seconds, const CpSolverResponse &r)
+    {
+        if (!ctl.stats)
+            return;
+        ctl.stats->add_duration("phase2_build", build_seconds);
+        ctl.stats->add_duration("cpsat_solve", solve_seconds);
+        ctl.stats->add_cpsat_status("phase2", CpSolverStatus_Name(r.status()));
+    }
 
-    vector<int> total_sections(I, 0);
-    for (int i = 0; i < I; ++i)
+    struct ComponentResult {
+        bool solved = false;
+        double objective = 0;
+        InitialSolution part;
+        vector<int> slot_used; // periods occupied per slot
+    };
+
+    ComponentResult solve_component(const CompiledProblem &cp, const ModelScope &scope, const Phase2Options &opts,
+                                    int workers, const SolveControl &ctl)
     {
-        for (int j = 0; j < J; ++j)
-        {
-            if (!eligible[i][j])
-                continue;
-            total_sections[i] += S[j];
-        }
+        auto build_start = chrono::steady_clock::now();
+        Phase2Model pm;
+        build_phase2_model(cp, pm, opts.debug_names, scope, break_symmetry(opts));
+        double build_seconds = seconds_since(build_start);
+        add_warm_start(cp, pm, opts, scope.capacity.empty() ? cp.capacity : scope.capacity);
+        auto solve_start = chrono::steady_clock::now();
+        CpSolverResponse response = solve_phase2_model(pm, sat_parameters(opts, workers), ctl);
+        record_solve(ctl, build_seconds, seconds_since(solve_start), response);
+
+        ComponentResult result;
+        if (!has_solution(response))
+            return result;
+        result.solved = true;
+        result.objective = response.objective_value();
+        result.part = solution_from_response(cp, pm, response);
+        result.slot_used.assign(cp.num_slots(), 0);
+        for (const auto &sv : pm.y)
+            if (SolutionBooleanValue(response, sv.var))
+                for (int m = sv.start; m < sv.start + cp.section_required_periods[sv.section]; ++m)
+                    ++result.slot_used[cp.slot(sv.day, m)];
+        return result;
     }
 
-    map<pair<int, int>, IntVar> overload;
-    for (int i = 0; i < I; ++i)
+    // Solve the components in parallel against their capacity share, then
+    // re-solve the ones that failed one by one against the capacity the others
+    // left unused. Falls back to the whole model, hinted with what was solved.
+    // All of it shares one opts.time_limit_seconds budget.
+    InitialSolution solve_decomposed(const ProblemData &data, vector<ModelScope> components,
+                                     const Phase2Options &opts, const SolveControl &ctl)
     {
-        int avg = (total_sections[i] + L - 1) / L;
-        for (int l = 0; l < L; ++l)
+        const CompiledProblem &cp = data.compiled;
+        const int C = (int)components.size();
+        auto solve_start = chrono::steady_clock::now();
+        split_capacity(cp, components);
+
+        // opts limited to the time left of the budget; false once it is spent
+        auto remaining = [&](Phase2Options &limited)
         {
-            LinearExpr sections_on_day = 0;
-            for (int j = 0; j < J; ++j)
+            limited = opts;
+            limited.time_limit_seconds = opts.time_limit_seconds - seconds_since(solve_start);
+            return limited.time_limit_seconds > 0;
+        };
+
+        int threads = min(solver_threads(opts.decompose_threads), C);
+        int workers = max(1, opts.workers / threads);
+        cout << "Phase2 decompose: " << C << " components (largest " << components[0].teachers.size()
+             << " teachers, " << components[0].courses.size() << " courses), " << threads
+             << " threads x " << workers << " CP-SAT workers\n";
+
+        vector<ComponentResult> results(C);
+        atomic<int> next{0};
+        vector<thread> pool;
+        for (int t = 0; t < threads; ++t)
+            pool.emplace_back([&]
+                              {
+                Phase2Options limited;
+                for (int c = next++; c < C && remaining(limited); c = next++)
+                    results[c] = solve_component(cp, components[c], limited, workers, ctl); });
+        for (auto &t : pool)
+            t.join();
+
+        // coordination pass: capacity left over by the solved components
+        vector<int> residual = cp.capacity;
+        for (const auto &r : results)
+            if (r.solved)
+                for (int slot = 0; slot < cp.num_slots(); ++slot)
+                    residual[slot] -= r.slot_used[slot];
+        int failed = 0;
+        Phase2Options limited;
+        for (int c = 0; c < C && !ctl.cancelled(); ++c)
+        {
+            if (results[c].solved)
+                continue;
+            if (!remaining(limited))
             {
-                if (!eligible[i][j])
-                    continue;
-                for (int k = 0; k < S[j]; ++k)
-                    for (int m0 = 0; m0 < M; ++m0)
-                    {
-                        auto it = Y.find({i, j, k, l, m0});
-                        if (it != Y.end())
-                            sections_on_day += it->second;
-                    }
+                ++failed;
+                continue;
+            }
+            components[c].capacity = residual;
+            results[c] = solve_component(cp, components[c], limited, opts.workers, ctl);
+            if (!results[c].solved)
+            {
+                ++failed;
+                continue;
             }
+            for (int slot = 0; slot < cp.num_slots(); ++slot)
+                residual[slot] -= results[c].slot_used[slot];
+        }
 
-            Domain d = Domain(0, total_sections[i]);
+        InitialSolution sol;
+        double objective = 0;
+        for (const auto &r : results)
+        {
+            sol.assignments.insert(sol.assignments.end(), r.part.assignments.begin(), r.part.assignments.end());
+            objective += r.objective;
+        }
 
-            overload[{i, l}] = model.NewIntVar(d).WithName(
-                "overload_t" + to_string(i) + "_d" + to_string(l));
-            model.AddGreaterOrEqual(overload[{i, l}], sections_on_day - avg);
+        if (ctl.cancelled() && (failed > 0 || any_of(results.begin(), results.end(), [](const ComponentResult &r)
+                                                     { return !r.solved; })))
+        {
+            cout << "No feasible solution found in Phase2.\n";
+            return InitialSolution();
+        }
+        if (failed > 0)
+        {
+            Phase2Options whole;
+            if (!remaining(whole))
+            {
+                cout << "Phase2 decompose: " << failed << " components unsolved and the time limit is spent, "
+                     << "skipping the whole-model fallback\n";
+                cout << "No feasible solution found in Phase2.\n";
+                return InitialSolution();
+            }
+            cout << "Phase2 decompose: " << failed << " components still infeasible, solving the whole model in the "
+                 << whole.time_limit_seconds << "s left\n";
+            whole.decompose = false;
+            whole.warm_start = sol.assignments;
+            whole.warm_start.insert(whole.warm_start.end(), opts.warm_start.begin(), opts.warm_start.end());
+            return construct_initial_solution(data, whole, ctl);
         }
-    }
 
-    // ---------- Objective ----------
-    // Maximize sum(PC[i][j] * P[i][j]) + sum_over_Y (sum_{t in covered periods} PT[i][l][t]) * Y
-    LinearExpr objective;
-    for (const auto &entry : P)
-    {
-        int i = entry.first.first;
-        int j = entry.first.second;
-        objective += LinearExpr(entry.second) * PC[i][j];
-    }
-    // time-pref contribution: for each Y, sum PT over each occupied period and weight by Y
-    for (auto &it : Y)
-    {
-        Key key = it.first;
-        int i, j, k, l, m0;
-        tie(i, j, k, l, m0) = key;
-        int r = data.courses[j].sections[k].required_periods;
-        int sumPT = 0;
-        for (int t = 0; t < r; ++t)
+        double elapsed = seconds_since(solve_start);
+        cout << "Phase2 decompose: objective " << objective << " in " << elapsed << "s\n";
+        if (ctl.on_incumbent)
         {
-            int m = m0 + t;
-            sumPT += PT[i][l][m];
+            IncumbentUpdate update;
+            update.phase = "phase2";
+            update.objective_value = (long long)llround(objective);
+            update.elapsed_seconds = elapsed;
+            update.assignments = assignments_to_json(sol.assignments);
+            ctl.on_incumbent(update);
         }
-        objective += LinearExpr(it.second) * sumPT;
+        return sol;
     }
-    for (auto &entry : overload)
+} // anonymous namespace
+
+InitialSolution construct_initial_solution(const ProblemData &data, const Phase2Options &opts, const SolveControl &ctl)
+{
+    const CompiledProblem &cp = data.compiled;
+
+    if (opts.decompose)
     {
-        objective -= entry.second;
+        vector<ModelScope> components = eligibility_components(cp);
+        if (components.size() > 1)
+            return solve_decomposed(data, std::move(components), opts, ctl);
+        cout << "Phase2 decompose: single component, solving the whole model\n";
     }
 
-    model.Maximize(objective);
+    auto build_start = chrono::steady_clock::now();
+    Phase2Model pm;
+    build_phase2_model(cp, pm, opts.debug_names, ModelScope(), break_symmetry(opts));
+    double build_seconds = seconds_since(build_start);
+    cout << "Phase2 model: " << pm.y.size() << " start variables, " << pm.p.size() << " teacher-course pairs, "
+         << pm.orderings << " section orderings, built in " << build_seconds << "s\n";
+
+    int fixed_count = add_warm_start(cp, pm, opts, cp.capacity);
 
     // ---------- Solve with solver parameters ----------
-    Model sat_model;
-    sat_model.Add(NewSatParameters("max_time_in_seconds:30 num_search_workers:8 log_search_progress: false"));
+    // streaming: report every improving solution CP-SAT finds
+    auto solve_start = chrono::steady_clock::now();
+    function<void(const CpSolverResponse &)> observer;
+    if (ctl.on_incumbent)
+        observer = [&](const CpSolverResponse &r)
+        {
+            IncumbentUpdate update;
+            update.phase = "phase2";
+            update.objective_value = (long long)llround(r.objective_value());
+            update.elapsed_seconds = seconds_since(solve_start);
+            update.assignments = assignments_to_json(solution_from_response(cp, pm, r).assignments);
+            ctl.on_incumbent(update);
+        };
 
-    auto response = SolveCpModel(model.Build(), &sat_model);
+    auto response = solve_phase2_model(pm, sat_parameters(opts, opts.workers), ctl, observer);
+    record_solve(ctl, build_seconds, seconds_since(solve_start), response);
 
     cout << "Phase2 solver status: " << CpSolverStatus_Name(response.status()) << "\n";
 
-    InitialSolution sol;
-    if (response.status() == CpSolverStatus::FEASIBLE || response.status() == CpSolverStatus::OPTIMAL)
+    // the fixed assignments can still rule out every completion (e.g. a course
+    // now needs more teachers than the fixed part leaves room for): retry hinting only
+    // within what is left of opts.time_limit_seconds
+    if (response.status() == CpSolverStatus::INFEASIBLE && fixed_count > 0)
     {
-        // Extract assignments from Y (start vars)
-        for (auto &entry : Y)
+        Phase2Options relaxed = opts;
+        relaxed.fix_unchanged = false;
+        relaxed.time_limit_seconds = opts.time_limit_seconds - seconds_since(build_start);
+        if (relaxed.time_limit_seconds > 0)
         {
-            Key key = entry.first;
-            const BoolVar &var = entry.second;
-            if (SolutionBooleanValue(response, var))
-            {
-                int i, j, k, l, m0;
-                tie(i, j, k, l, m0) = key;
-                InitialSolution::Assignment a;
-                a.teacher_id = data.teachers[i].id;
-                a.course_id = data.courses[j].id;
-                a.section_id = data.courses[j].sections[k].id;
-                a.day = data.classrooms.days[l];
-                a.period = data.classrooms.periods[m0]; // start period
-                sol.assignments.push_back(a);
-            }
+            cout << "Phase2 infeasible with fixed warm start assignments, retrying with hints only.\n";
+            return construct_initial_solution(data, relaxed, ctl);
         }
+        cout << "Phase2 infeasible with fixed warm start assignments and the time limit is spent.\n";
+    }
+
+    InitialSolution sol;
+    if (has_solution(response))
+    {
+        sol = solution_from_response(cp, pm, response);
     }
     else
     {
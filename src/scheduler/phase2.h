@@ -1,5 +1,6 @@
 #pragma once
 #include "phase1.h"
+#include "solve_control.h"
 using namespace std;
 struct InitialSolution {
     struct Assignment {
@@ -13,5 +14,40 @@ struct InitialSolution {
     std::vector<Assignment> assignments;
 };
 
+// Tham số cho phase 2
+struct Phase2Options {
+    // Warm start: a previous schedule handed to CP-SAT as a solution hint.
+    // Entries that no longer fit the problem (unknown ids, ineligible teacher, ...) are ignored.
+    vector<InitialSolution::Assignment> warm_start;
+    bool fix_unchanged = false; // keep the still-valid warm start assignments fixed instead of only hinting them
+    bool debug_names = false;   // name every CP-SAT variable (Y_t0_c1_s0_d2_m3, ...) for model dumps
+    bool symmetry_breaking = true; // order interchangeable sections of a course by start; off with a warm start
+
+    // CP-SAT parameters
+    double time_limit_seconds = 30;
+    int workers = 8;                 // parallel CP-SAT search workers
+    double relative_gap_limit = 0;   // stop once (bound - objective) / objective is below this, 0 = prove optimality
+    bool has_seed = false;
+    int seed = 0;
+    bool stop_after_first_solution = false; // hand the first feasible schedule to Phase 3
+
+    // Solve each connected component of the teacher-course eligibility graph
+    // as its own model, in parallel, with a share of the classroom capacity
+    bool decompose = false;
+    int decompose_threads = 0; // 0 = one per hardware thread; workers are divided between them
+};
+
+// Read Phase2Options from the "phase2" object of a request, missing keys keep their defaults.
+// "profile" presets several keys at once and is applied first, explicit keys override it:
+//   "default"       : the values above
+//   "fast_feasible" : stop at the first feasible schedule and leave the improving to Phase 3
+// Throws invalid_argument when j is not an object, a key has the wrong type or the profile is unknown.
+Phase2Options phase2_options_from_json(const json &j);
+
+// Parse an assignments array (layout of solution.assignments in the /schedule response)
+vector<InitialSolution::Assignment> assignments_from_json(const json &arr);
+
 // Hàm xây dựng phương án khởi đầu bằng Integer Programming
-InitialSolution construct_initial_solution(const ProblemData &data);
\ No newline at end of file
+InitialSolution construct_initial_solution(const ProblemData &data,
+                                           const Phase2Options &opts = Phase2Options(),
+                                           const SolveControl &ctl = SolveControl());
\ No newline at end of file
@@ -0,0 +1,390 @@
+#include "phase2_model.h"
+#include "objective.h"
+#include "ortools/sat/cp_model_solver.h"
+#include "ortools/util/time_limit.h"
+#include <algorithm>
+#include <string>
+
+using namespace operations_research;
+using namespace operations_research::sat;
+using namespace std;
+
+namespace
+{
+    // Group variable ids 0..num_vars-1 by key. keys_of(v, emit) calls emit(key)
+    // for every key of v; it runs twice (count, then fill).
+    template <class KeysOf>
+    VarLists group_vars(int num_keys, int num_vars, KeysOf keys_of)
+    {
+        VarLists lists;
+        lists.begin.assign(num_keys + 1, 0);
+        for (int v = 0; v < num_vars; ++v)
+            keys_of(v, [&](int key)
+                    { ++lists.begin[key + 1]; });
+        for (int k = 0; k < num_keys; ++k)
+            lists.begin[k + 1] += lists.begin[k];
+        lists.ids.resize(lists.begin[num_keys]);
+        vector<int> fill(lists.begin.begin(), lists.begin.end() - 1);
+        for (int v = 0; v < num_vars; ++v)
+            keys_of(v, [&](int key)
+                    { lists.ids[fill[key]++] = v; });
+        return lists;
+    }
+
+    LinearExpr sum_of(const Phase2Model &pm, VarLists::Range ids)
+    {
+        LinearExpr sum;
+        for (int v : ids)
+            sum += pm.y[v].var;
+        return sum;
+    }
+
+    vector<BoolVar> bools_of(const Phase2Model &pm, VarLists::Range ids)
+    {
+        vector<BoolVar> vars;
+        vars.reserve(ids.size());
+        for (int v : ids)
+            vars.push_back(pm.y[v].var);
+        return vars;
+    }
+} // anonymous namespace
+
+int Phase2Model::find_start(int teacher, int section, int day, int start) const
+{
+    for (int v : by_section[section])
+        if (y[v].teacher == teacher && y[v].day == day && y[v].start == start)
+            return v;
+    return -1;
+}
+
+void build_phase2_model(const CompiledProblem &cp, Phase2Model &pm, bool name_vars, const ModelScope &scope,
+                        bool break_symmetry)
+{
+    CpModelBuilder &model = pm.builder;
+
+    const int I = cp.num_teachers;
+    const int J = cp.num_courses;
+    const int L = cp.num_days;
+    const int M = cp.num_periods;
+
+    vector<int> teachers = scope.teachers, courses = scope.courses;
+    if (teachers.empty())
+        for (int i = 0; i < I; ++i)
+            teachers.push_back(i);
+    if (courses.empty())
+        for (int j = 0; j < J; ++j)
+            courses.push_back(j);
+    const vector<int> &capacity = scope.capacity.empty() ? cp.capacity : scope.capacity;
+    vector<char> teacher_in(I, 0);
+    for (int i : teachers)
+        teacher_in[i] = 1;
+
+    // ---------- Variables ----------
+    // P(i,j) : teacher i teaches course j, only for eligible pairs
+    pm.pair_of.assign((size_t)I * J, -1);
+    for (int j : courses)
+        for (int i = 0; i < I; ++i)
+        {
+            if (!teacher_in[i] || !cp.eligible(i, j))
+                continue;
+            BoolVar var = model.NewBoolVar();
+            if (name_vars)
+                var = var.WithName("P_t" + to_string(i) + "_c" + to_string(j));
+            pm.pair_of[(size_t)i * J + j] = (int)pm.p.size();
+            pm.p.push_back(var);
+            pm.p_key.push_back({i, j});
+        }
+
+    // Y(i,j,k,l,m0), one pass over eligible pairs; starts that overflow the day get no variable
+    for (size_t q = 0; q < pm.p_key.size(); ++q)
+    {
+        int i = pm.p_key[q].first;
+        int j = pm.p_key[q].second;
+        for (int s = cp.course_section_begin[j]; s < cp.course_section_begin[j + 1]; ++s)
+        {
+            int r = cp.section_required_periods[s];
+            const PinnedStart *pin = scope.pinned.empty() || scope.pinned[s].teacher < 0 ? nullptr : &scope.pinned[s];
+            if (pin && pin->teacher != i)
+                continue;
+            for (int l = 0; l < L; ++l)
+                for (int m0 = 0; m0 + r <= M; ++m0)
+                {
+                    if (pin && (pin->day != l || pin->start != m0))
+                        continue;
+                    if (!pin && !scope.unavailable.empty() &&
+                        any_of(scope.unavailable.begin() + (i * L + l) * M + m0,
+                               scope.unavailable.begin() + (i * L + l) * M + m0 + r, [](char c)
+                               { return c != 0; }))
+                        continue;
+                    BoolVar var = model.NewBoolVar();
+                    if (name_vars)
+                        var = var.WithName("Y_t" + to_string(i) + "_c" + to_string(j) +
+                                           "_s" + to_string(s - cp.course_section_begin[j]) +
+                                           "_d" + to_string(l) + "_m" + to_string(m0));
+                    pm.y.push_back({i, j, s, l, m0, var});
+                }
+        }
+    }
+
+    const int Y = (int)pm.y.size();
+    auto covered = [&](int v, auto emit_slot)
+    {
+        const StartVar &sv = pm.y[v];
+        int r = cp.section_required_periods[sv.section];
+        for (int m = sv.start; m < sv.start + r; ++m)
+            emit_slot(m);
+    };
+    pm.by_section = group_vars(cp.num_sections, Y, [&](int v, auto emit)
+                               { emit(pm.y[v].section); });
+    pm.by_pair = group_vars((int)pm.p.size(), Y, [&](int v, auto emit)
+                            { emit(pm.pair_of[(size_t)pm.y[v].teacher * J + pm.y[v].course]); });
+    pm.by_slot = group_vars(L * M, Y, [&](int v, auto emit)
+                            { covered(v, [&](int m)
+                                      { emit(cp.slot(pm.y[v].day, m)); }); });
+    pm.by_teacher_slot = group_vars(I * L * M, Y, [&](int v, auto emit)
+                                    { covered(v, [&](int m)
+                                              { emit((pm.y[v].teacher * L + pm.y[v].day) * M + m); }); });
+    pm.by_course_slot = group_vars(J * L * M, Y, [&](int v, auto emit)
+                                   { covered(v, [&](int m)
+                                             { emit((pm.y[v].course * L + pm.y[v].day) * M + m); }); });
+    pm.by_teacher_day = group_vars(I * L, Y, [&](int v, auto emit)
+                                   { emit(pm.y[v].teacher * L + pm.y[v].day); });
+
+    // ---------- Constraints ----------
+    // Constraints the rest of the model already implies are left out, so
+    // presolve has less to prove redundant: a list whose starts all belong to
+    // one section is covered by constraint 1, a bound no choice can reach is
+    // dropped, and pairs the scope decides get P fixed.
+    vector<int> seen(cp.num_sections, -1);
+    int stamp = 0;
+    auto distinct_sections = [&](VarLists::Range ids)
+    {
+        ++stamp;
+        int count = 0;
+        for (int v : ids)
+            if (seen[pm.y[v].section] != stamp)
+            {
+                seen[pm.y[v].section] = stamp;
+                ++count;
+            }
+        return count;
+    };
+
+    // 1) Each section must be scheduled exactly once (one teacher, one day, one start);
+    //    this also forces the only variable of a pinned section to 1
+    for (int j : courses)
+        for (int s = cp.course_section_begin[j]; s < cp.course_section_begin[j + 1]; ++s)
+            model.AddExactlyOne(bools_of(pm, pm.by_section[s]));
+
+    // 2) Link P and Y: if any Y(i,j,k,.,.) = 1 => P(i,j) = 1, and if P=1 then sumY >= 1.
+    //    P is fixed when the sections decide it: 0 without any start left (all pinned to
+    //    other teachers), 1 when every section can only go to teacher i.
+    vector<int> only_teacher(cp.num_sections, -1); // the single teacher of all starts of s, -1 if several
+    for (int j : courses)
+        for (int s = cp.course_section_begin[j]; s < cp.course_section_begin[j + 1]; ++s)
+        {
+            auto starts = pm.by_section[s];
+            if (starts.empty())
+                continue;
+            int i = pm.y[*starts.begin()].teacher;
+            for (int v : starts)
+                if (pm.y[v].teacher != i)
+                    i = -1;
+            only_teacher[s] = i;
+        }
+    vector<int> teacher_pairs(I, 0), course_pairs(J, 0);
+    for (size_t q = 0; q < pm.p.size(); ++q)
+    {
+        int i = pm.p_key[q].first;
+        int j = pm.p_key[q].second;
+        auto starts = pm.by_pair[(int)q];
+        if (starts.empty())
+        {
+            model.FixVariable(pm.p[q], false);
+            continue;
+        }
+        ++teacher_pairs[i];
+        ++course_pairs[j];
+        bool forced = true;
+        for (int s = cp.course_section_begin[j]; s < cp.course_section_begin[j + 1]; ++s)
+            forced = forced && only_teacher[s] == i;
+        if (forced)
+        {
+            model.FixVariable(pm.p[q], true);
+            continue;
+        }
+        LinearExpr sumY_ij = sum_of(pm, starts);
+        int sections = distinct_sections(starts); // tighter than sections_of(j) when some are pinned elsewhere
+        if (sections == 1)
+            model.AddEquality(sumY_ij, pm.p[q]);
+        else
+        {
+            model.AddLessOrEqual(sumY_ij, LinearExpr(pm.p[q]) * sections);
+            model.AddGreaterOrEqual(sumY_ij, pm.p[q]);
+        }
+    }
+
+    // 3) Teacher max/min courses: sum_j P[i,j] <= max_courses, each teacher must teach >=1
+    // 4) Each course must be taught by at least min_teachers, at most max_teachers
+    //    (min_teachers <= 1 already follows from 1 and 2 for a course with sections)
+    vector<LinearExpr> teacher_courses(I), course_teachers(J);
+    for (size_t q = 0; q < pm.p.size(); ++q)
+    {
+        teacher_courses[pm.p_key[q].first] += pm.p[q];
+        course_teachers[pm.p_key[q].second] += pm.p[q];
+    }
+    for (int i : teachers)
+    {
+        model.AddGreaterOrEqual(teacher_courses[i], 1);
+        if (teacher_pairs[i] > cp.teacher_max_courses[i])
+            model.AddLessOrEqual(teacher_courses[i], cp.teacher_max_courses[i]);
+    }
+    for (int j : courses)
+    {
+        if (cp.course_min_teachers[j] > 1 || cp.sections_of(j) == 0)
+            model.AddGreaterOrEqual(course_teachers[j], cp.course_min_teachers[j]);
+        if (course_pairs[j] > cp.course_max_teachers[j])
+            model.AddLessOrEqual(course_teachers[j], cp.course_max_teachers[j]);
+    }
+
+    // 5) Classroom capacity per slot (only where more sections can cover the slot than it
+    //    has classrooms), and at most one section of a course per slot
+    for (int l = 0; l < L; ++l)
+        for (int m = 0; m < M; ++m)
+        {
+            auto in_slot = pm.by_slot[cp.slot(l, m)];
+            if (distinct_sections(in_slot) > capacity[cp.slot(l, m)])
+                model.AddLessOrEqual(sum_of(pm, in_slot), capacity[cp.slot(l, m)]);
+        }
+    for (int key = 0; key < J * L * M; ++key)
+    {
+        auto course_slot = pm.by_course_slot[key];
+        if (distinct_sections(course_slot) > 1)
+            model.AddAtMostOne(bools_of(pm, course_slot));
+    }
+
+    // 6) Each teacher at most 1 section per time slot
+    for (int key = 0; key < I * L * M; ++key)
+    {
+        auto teacher_slot = pm.by_teacher_slot[key];
+        if (distinct_sections(teacher_slot) > 1)
+            model.AddAtMostOne(bools_of(pm, teacher_slot));
+    }
+
+    // 7) Each teacher schedule should be spread evenly over days (add penalty when overloaded)
+    vector<int> total_sections(I, 0);
+    for (const auto &key : pm.p_key)
+        total_sections[key.first] += cp.sections_of(key.second);
+    vector<int> day_target = daily_section_targets(cp);
+
+    pm.overload.reserve(teachers.size() * L);
+    for (int i : teachers)
+    {
+        int avg = day_target[i];
+        for (int l = 0; l < L; ++l)
+        {
+            IntVar over = model.NewIntVar(Domain(0, total_sections[i]));
+            if (name_vars)
+                over = over.WithName("overload_t" + to_string(i) + "_d" + to_string(l));
+            model.AddGreaterOrEqual(over, sum_of(pm, pm.by_teacher_day[i * L + l]) - avg);
+            pm.overload.push_back(over);
+        }
+    }
+
+    // 8) Symmetry breaking: free sections of a course with the same required_periods are
+    //    interchangeable (swapping them changes neither feasibility nor the objective), so
+    //    only keep the labelling that starts them in increasing slot order l * M + m0.
+    //    The order is strict since 5 keeps two sections of a course from sharing a slot.
+    if (break_symmetry)
+    {
+        auto start_key = [&](int s)
+        {
+            LinearExpr key;
+            for (int v : pm.by_section[s])
+                key += LinearExpr(pm.y[v].var) * (pm.y[v].day * M + pm.y[v].start);
+            return key;
+        };
+        for (int j : courses)
+        {
+            vector<pair<int, int>> last; // (required periods, previous free section)
+            for (int s = cp.course_section_begin[j]; s < cp.course_section_begin[j + 1]; ++s)
+            {
+                if (!scope.pinned.empty() && scope.pinned[s].teacher >= 0)
+                    continue;
+                int r = cp.section_required_periods[s];
+                auto it = find_if(last.begin(), last.end(), [&](const pair<int, int> &e)
+                                  { return e.first == r; });
+                if (it == last.end())
+                {
+                    last.push_back({r, s});
+                    continue;
+                }
+                model.AddLessOrEqual(start_key(it->second) + 1, start_key(s));
+                it->second = s;
+                ++pm.orderings;
+            }
+        }
+    }
+
+    // ---------- Objective ----------
+    // Maximize sum(PC[i][j] * P[i][j]) + sum_over_Y (sum_{t in covered periods} PT[i][l][t]) * Y - overload
+    // (the same score evaluate_objective() computes for a schedule)
+    vector<int64_t> pc_coef;
+    pc_coef.reserve(pm.p.size());
+    for (const auto &key : pm.p_key)
+        pc_coef.push_back(cp.pc(key.first, key.second));
+
+    vector<BoolVar> y_vars;
+    vector<int64_t> pt_coef;
+    y_vars.reserve(Y);
+    pt_coef.reserve(Y);
+    for (const auto &sv : pm.y)
+    {
+        y_vars.push_back(sv.var);
+        pt_coef.push_back(block_preference(cp, sv.teacher, sv.section, sv.day, sv.start));
+    }
+
+    pm.objective = LinearExpr::WeightedSum(pm.p, pc_coef);
+    pm.objective += LinearExpr::WeightedSum(y_vars, pt_coef);
+    for (const auto &over : pm.overload)
+        pm.objective -= over;
+
+    model.Maximize(pm.objective);
+}
+
+CpSolverResponse solve_phase2_model(const Phase2Model &pm, const SatParameters &params, const SolveControl &ctl,
+                                    const function<void(const CpSolverResponse &)> &observer)
+{
+    Model sat_model;
+    sat_model.Add(NewSatParameters(params));
+    // cancellation: the solver stops as soon as *ctl.cancel becomes true
+    if (ctl.cancel)
+        sat_model.GetOrCreate<TimeLimit>()->RegisterExternalBooleanAsLimit(ctl.cancel);
+    if (observer)
+        sat_model.Add(NewFeasibleSolutionObserver(observer));
+    return SolveCpModel(pm.builder.Build(), &sat_model);
+}
+
+bool has_solution(const CpSolverResponse &r)
+{
+    return r.status() == CpSolverStatus::FEASIBLE || r.status() == CpSolverStatus::OPTIMAL;
+}
+
+InitialSolution solution_from_response(const CompiledProblem &cp, const Phase2Model &pm,
+                                       const CpSolverResponse &r)
+{
+    InitialSolution out;
+    for (const auto &sv : pm.y)
+    {
+        if (!SolutionBooleanValue(r, sv.var))
+            continue;
+        InitialSolution::Assignment a;
+        a.teacher_id = cp.teacher_ids[sv.teacher];
+        a.course_id = cp.course_ids[sv.course];
+        a.section_id = cp.section_ids[sv.section];
+        a.day = cp.days[sv.day];
+        a.period = cp.periods[sv.start]; // start period
+        out.assignments.push_back(a);
+    }
+    return out;
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include "phase2.h"
+#include "ortools/sat/cp_model.h"
+#include "ortools/sat/sat_parameters.pb.h"
+#include <functional>
+#include <vector>
+using namespace std;
+
+namespace sat = operations_research::sat;
+
+// Variable ids grouped by a dense key, stored back to back (CSR layout)
+struct VarLists {
+    vector<int> begin; // key k owns ids[begin[k], begin[k + 1])
+    vector<int> ids;
+
+    struct Range {
+        const int *first;
+        const int *last;
+        const int *begin() const { return first; }
+        const int *end() const { return last; }
+        bool empty() const { return first == last; }
+        size_t size() const { return last - first; }
+    };
+    Range operator[](int key) const { return {ids.data() + begin[key], ids.data() + begin[key + 1]}; }
+};
+
+// Y(i,j,k,l,m0): teacher i starts section s (global index, course j) on day l at period m0
+struct StartVar {
+    int teacher;
+    int course;
+    int section;
+    int day;
+    int start;
+    sat::BoolVar var;
+};
+
+// Mô hình CP-SAT của phase 2 cùng các bảng tra biến
+struct Phase2Model {
+    sat::CpModelBuilder builder;
+
+    // one entry per eligible teacher, section, day and start that fits the day
+    vector<StartVar> y;
+
+    // P(i,j) for eligible pairs; pair_of[i * J + j] is the index into p, -1 when not eligible
+    vector<int> pair_of;
+    vector<sat::BoolVar> p;
+    vector<pair<int, int>> p_key; // (teacher, course) of each p
+
+    // lists of y ids
+    VarLists by_section;      // section s -> starts of s
+    VarLists by_pair;         // pair index -> starts of that teacher and course
+    VarLists by_slot;         // slot (l, m) -> starts covering it
+    VarLists by_teacher_slot; // (i * L + l) * M + m -> starts of teacher i covering (l, m)
+    VarLists by_course_slot;  // (j * L + l) * M + m -> starts of course j covering (l, m)
+    VarLists by_teacher_day;  // i * L + l -> starts of teacher i on day l
+
+    vector<sat::IntVar> overload; // per teacher of the scope and day, sections above the even spread
+    int orderings = 0;            // symmetry-breaking constraints between interchangeable sections
+    sat::LinearExpr objective;    // the maximized Phase 2 objective, for callers that extend it
+
+    // y id of teacher i starting global section s at (l, m0), -1 if there is no such variable
+    int find_start(int teacher, int section, int day, int start) const;
+};
+
+// Fixed teacher and start of a section, teacher < 0 when the section is free
+struct PinnedStart {
+    int teacher = -1;
+    int day = 0;
+    int start = 0;
+};
+
+// Part of the problem a model covers; an empty field means the whole problem
+struct ModelScope {
+    vector<int> teachers;
+    vector<int> courses;  // every section of these courses is scheduled
+    vector<int> capacity; // classrooms per slot (l * M + m) available to this model, replaces cp.capacity
+    vector<PinnedStart> pinned; // per global section; a pinned section gets a single Y variable, forced to 1
+    vector<char> unavailable;   // (i * L + l) * M + m: teacher i cannot teach at (l, m); no free start covers it
+};
+
+// Build variables, constraints 1-7 and the objective of Phase 2 into pm.
+// name_vars gives every variable a readable name (for model dumps); it costs a string per variable.
+// break_symmetry orders interchangeable free sections of a course by start slot, so the
+// solution may swap their section ids; leave it off when hints or fixes name specific sections.
+void build_phase2_model(const CompiledProblem &cp, Phase2Model &pm, bool name_vars = false,
+                        const ModelScope &scope = ModelScope(), bool break_symmetry = false);
+
+// Solve pm; stops early when ctl is cancelled. observer (optional) sees every improving solution.
+sat::CpSolverResponse solve_phase2_model(const Phase2Model &pm, const sat::SatParameters &params, const SolveControl &ctl,
+                                         const function<void(const sat::CpSolverResponse &)> &observer = nullptr);
+
+bool has_solution(const sat::CpSolverResponse &r);
+
+// Assignments (start period) chosen by a solver response
+InitialSolution solution_from_response(const CompiledProblem &cp, const Phase2Model &pm,
+                                       const sat::CpSolverResponse &r);
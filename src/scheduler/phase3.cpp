@@ -1,630 +1,1350 @@
 // phase3.cpp
 #include "phase3.h"
+#include "objective.h"
 #include <vector>
 #include <algorithm>
 #include <random>
 #include <chrono>
 #include <cmath>
 #include <iostream>
-#include <deque>
-#include <numeric>
-#include <unordered_set>
+#include <memory>
 #include <unordered_map>
-#include <sstream>
 #include <map>
+#include <cassert>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <limits>
+#include <stdexcept>
 
 using namespace std;
 
 namespace
 {
-    mt19937 rng(chrono::steady_clock::now().time_since_epoch().count());
+    // Index form of OptimalSolution::Assignment
+    using Assign = Placement;
 
-    // Build string key for slot
-    static inline string slot_key(const string &day, const string &period)
+    struct Schedule
     {
-        return day + "|" + period;
-    }
+        vector<Assign> assignments;
+        int objective_value = 0;
+    };
 
-    // Index structure to allow O(1) feasibility checks (per candidate)
+    // Persistent index over the current schedule. Every slot covered by an
+    // assignment's block is recorded; move operators update it in place and
+    // roll it back with undo_move, so feasibility checks never rebuild it.
+    // All arrays are flat and sized once per search: updating the index never
+    // allocates. score follows the schedule's objective (see objective.h).
+    //
+    // Occupancy is kept as bit sets over the slots of the week. A block covers
+    // consecutive slots (slot = day * periods + period), so checking it against
+    // a set is a masked AND of one word, or two when it straddles a boundary.
     struct SolIndex
     {
-        // slot -> count
-        unordered_map<string, int> slot_count;
+        int slot_words = 0; // 64-bit words per slot bit set
+        int num_teachers = 0;
+        int score = 0;
+
+        // slot -> count, and the slots whose classrooms are all taken
+        vector<int> slot_count;
+        vector<uint64_t> full_slots;
+
+        // teacher -> busy slots, words [teacher * slot_words, (teacher + 1) * slot_words)
+        vector<uint64_t> teacher_busy;
+
+        // course -> slots taken by one of its sections (no two sections of a course at once)
+        vector<uint64_t> course_busy;
 
-        // teacher -> set of slot_keys (busy)
-        unordered_map<string, unordered_set<string>> teacher_busy;
+        // (course, teacher) -> number of sections, at course * num_teachers + teacher,
+        // and course -> number of distinct teachers (for min/max teacher bounds)
+        vector<int> course_teacher_sections;
+        vector<int> course_teachers;
 
-        // course -> slot_key -> section_id (to check same-course conflict)
-        unordered_map<string, unordered_map<string, string>> course_slot_section;
+        // teacher -> number of distinct courses (for max_courses)
+        vector<int> teacher_courses;
 
-        // course -> set of teachers teaching it (for min/max teacher bounds)
-        unordered_map<string, unordered_set<string>> course_teachers;
+        // (teacher, day) -> sections, at teacher * num_days + day, and the
+        // per-teacher count above which a day is overloaded
+        vector<int> teacher_day_sections;
+        vector<int> day_target;
     };
 
-    static SolIndex build_index(const OptimalSolution &sol)
+    // A move replaces up to two assignments; before[] keeps what it replaced
+    // and delta is the exact objective change of the replacement
+    struct Move
     {
-        SolIndex idx;
-        for (const auto &a : sol.assignments)
+        int n = 0;
+        int pos[2];
+        Assign before[2];
+        int delta = 0;
+        int checks = 0; // feasibility checks spent by the operator, found or not
+    };
+
+    // Calls f(word, mask) for the words covering slots [first, first + len)
+    template <class F>
+    static inline void for_each_run_word(int first, int len, F f)
+    {
+        int offset = first & 63;
+        if (offset + len <= 64) // the usual case: the block fits in one word
         {
-            string sk = slot_key(a.day, a.period);
-            idx.slot_count[sk]++;
-            idx.teacher_busy[a.teacher_id].insert(sk);
-            idx.course_slot_section[a.course_id][sk] = a.section_id;
-            idx.course_teachers[a.course_id].insert(a.teacher_id);
+            f(first >> 6, (len == 64 ? ~0ULL : ((1ULL << len) - 1)) << offset);
+            return;
         }
-        return idx;
+        while (len > 0)
+        {
+            int n = min(len, 64 - offset);
+            uint64_t mask = (n == 64 ? ~0ULL : ((1ULL << n) - 1)) << offset;
+            f(first >> 6, mask);
+            first += n;
+            len -= n;
+            offset = 0; // every later word starts at bit 0
+        }
+    }
+
+    static inline bool any_in_run(const uint64_t *bits, int first, int len)
+    {
+        bool hit = false;
+        for_each_run_word(first, len, [&](int w, uint64_t mask)
+                          { hit |= (bits[w] & mask) != 0; });
+        return hit;
     }
 
-    static int get_required_periods(const ProblemData &data, const string &course_id, const string &section_id)
+    static inline void set_run(uint64_t *bits, int first, int len)
     {
-        for (const auto &c : data.courses)
+        for_each_run_word(first, len, [&](int w, uint64_t mask)
+                          { bits[w] |= mask; });
+    }
+
+    static inline void clear_run(uint64_t *bits, int first, int len)
+    {
+        for_each_run_word(first, len, [&](int w, uint64_t mask)
+                          { bits[w] &= ~mask; });
+    }
+
+    static inline void set_full(SolIndex &idx, int slot, bool full)
+    {
+        uint64_t bit = 1ULL << (slot & 63);
+        uint64_t &w = idx.full_slots[slot >> 6];
+        w = (w & ~bit) | (bit & (0 - (uint64_t)full));
+    }
+
+    static void index_add(SolIndex &idx, const Assign &a, const CompiledProblem &cp)
+    {
+        int r = cp.section_required_periods[a.section];
+        int first = cp.slot(a.day, a.period);
+        set_run(&idx.teacher_busy[(size_t)a.teacher * idx.slot_words], first, r);
+        set_run(&idx.course_busy[(size_t)a.course * idx.slot_words], first, r);
+        for (int t = 0; t < r; ++t)
         {
-            if (c.id == course_id)
-            {
-                for (const auto &s : c.sections)
-                    if (s.id == section_id)
-                        return s.required_periods;
-            }
+            int sk = first + t;
+            set_full(idx, sk, ++idx.slot_count[sk] >= cp.capacity[sk]);
+            idx.score += cp.pt(a.teacher, a.day, a.period + t);
+        }
+        if (idx.course_teacher_sections[a.course * idx.num_teachers + a.teacher]++ == 0)
+        {
+            idx.course_teachers[a.course]++;
+            idx.teacher_courses[a.teacher]++;
+            idx.score += cp.pc(a.teacher, a.course);
+        }
+        if (idx.teacher_day_sections[a.teacher * cp.num_days + a.day]++ >= idx.day_target[a.teacher])
+            idx.score -= 1; // one more section of overload
+    }
+
+    static void index_remove(SolIndex &idx, const Assign &a, const CompiledProblem &cp)
+    {
+        int r = cp.section_required_periods[a.section];
+        int first = cp.slot(a.day, a.period);
+        clear_run(&idx.teacher_busy[(size_t)a.teacher * idx.slot_words], first, r);
+        clear_run(&idx.course_busy[(size_t)a.course * idx.slot_words], first, r);
+        for (int t = 0; t < r; ++t)
+        {
+            int sk = first + t;
+            set_full(idx, sk, --idx.slot_count[sk] >= cp.capacity[sk]);
+            idx.score -= cp.pt(a.teacher, a.day, a.period + t);
         }
-        return 1;
+        if (--idx.course_teacher_sections[a.course * idx.num_teachers + a.teacher] == 0)
+        {
+            idx.course_teachers[a.course]--;
+            idx.teacher_courses[a.teacher]--;
+            idx.score -= cp.pc(a.teacher, a.course);
+        }
+        if (--idx.teacher_day_sections[a.teacher * cp.num_days + a.day] >= idx.day_target[a.teacher])
+            idx.score += 1;
     }
 
-    static string assignment_sig(const OptimalSolution::Assignment &a)
+    // (Re)build idx for sol, reusing its arrays once they have been sized
+    static void build_index(SolIndex &idx, const Schedule &sol, const CompiledProblem &cp)
     {
-        ostringstream oss;
-        oss << a.teacher_id << "|" << a.course_id << "|" << a.section_id << "|" << a.day << "|" << a.period;
-        return oss.str();
+        idx.slot_words = (cp.num_slots() + 63) / 64;
+        idx.num_teachers = cp.num_teachers;
+        idx.slot_count.assign(cp.num_slots(), 0);
+        idx.full_slots.assign(idx.slot_words, 0);
+        for (int sk = 0; sk < cp.num_slots(); ++sk)
+            set_full(idx, sk, cp.capacity[sk] <= 0);
+        idx.teacher_busy.assign((size_t)cp.num_teachers * idx.slot_words, 0);
+        idx.course_busy.assign((size_t)cp.num_courses * idx.slot_words, 0);
+        idx.course_teacher_sections.assign((size_t)cp.num_courses * cp.num_teachers, 0);
+        idx.course_teachers.assign(cp.num_courses, 0);
+        idx.teacher_courses.assign(cp.num_teachers, 0);
+        idx.teacher_day_sections.assign((size_t)cp.num_teachers * cp.num_days, 0);
+        if (idx.day_target.empty())
+            idx.day_target = daily_section_targets(cp);
+        idx.score = 0;
+        for (const auto &a : sol.assignments)
+            index_add(idx, a, cp);
     }
 
-    static string pair_sig(const OptimalSolution::Assignment &a, const OptimalSolution::Assignment &b)
+    // ---------- Move signatures ----------
+    static inline uint64_t mix64(uint64_t x)
     {
-        string s1 = assignment_sig(a), s2 = assignment_sig(b);
-        if (s1 < s2)
-            return s1 + "<=>" + s2;
-        return s2 + "<=>" + s1;
+        // splitmix64 finalizer
+        x += 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
     }
 
-    // ---------- Feasibility using index ----------
-    // Check course teacher bounds using idx
-    static bool check_course_teacher_bounds(const SolIndex &idx, const ProblemData &data)
+    // The course is implied by the (global) section
+    static inline uint64_t assignment_sig(const Assign &a)
     {
-        for (const auto &c : data.courses)
+        return mix64(((uint64_t)(uint32_t)a.teacher << 32 | (uint32_t)a.section) ^
+                     mix64((uint64_t)(uint32_t)a.day << 32 | (uint32_t)a.period));
+    }
+
+    // Order-independent signature of a move between two assignments; never 0
+    static inline uint64_t pair_sig(const Assign &a, const Assign &b)
+    {
+        uint64_t x = assignment_sig(a), y = assignment_sig(b);
+        if (x > y)
+            swap(x, y);
+        uint64_t sig = mix64(x ^ mix64(y));
+        return sig ? sig : 1;
+    }
+
+    // The last `tenure` accepted move signatures. A linear scan over a few
+    // hundred contiguous words beats hashing here and never allocates.
+    class TabuList
+    {
+    public:
+        explicit TabuList(size_t tenure) : ring_(tenure, 0) {}
+
+        bool contains(uint64_t sig) const
         {
-            auto it = idx.course_teachers.find(c.id);
-            int cnt = (it == idx.course_teachers.end()) ? 0 : (int)it->second.size();
-            if (cnt < c.min_teachers || cnt > c.max_teachers)
-                return false;
+            return find(ring_.begin(), ring_.end(), sig) != ring_.end();
         }
-        return true;
+
+        void push(uint64_t sig)
+        {
+            ring_[next_] = sig;
+            next_ = next_ + 1 == ring_.size() ? 0 : next_ + 1;
+            size_ = min(size_ + 1, ring_.size());
+        }
+
+        size_t size() const { return size_; }
+
+    private:
+        vector<uint64_t> ring_; // 0 = empty
+        size_t next_ = 0;
+        size_t size_ = 0;
+    };
+
+    // How often each move was accepted, in a fixed table of counters indexed
+    // by signature. Every decay_interval accepted moves all counts are halved,
+    // so old habits fade and memory stays flat however long the search runs.
+    // Colliding signatures share a counter, which only overstates a penalty.
+    class MoveFrequency
+    {
+    public:
+        static constexpr size_t kSlots = 1 << 13;
+        static constexpr int kDecayInterval = 2048;
+
+        MoveFrequency() : counts_(kSlots, 0) {}
+
+        int count(uint64_t sig) const { return counts_[sig & (kSlots - 1)]; }
+
+        void add(uint64_t sig)
+        {
+            uint16_t &c = counts_[sig & (kSlots - 1)];
+            if (c == 0)
+                ++entries_;
+            if (c < numeric_limits<uint16_t>::max())
+                ++c;
+            if (++since_decay_ == kDecayInterval)
+            {
+                for (auto &x : counts_)
+                    if (x == 1)
+                    {
+                        x = 0;
+                        --entries_;
+                    }
+                    else
+                        x >>= 1;
+                since_decay_ = 0;
+            }
+        }
+
+        // non-zero counters, kept up to date by add
+        size_t entries() const { return entries_; }
+
+    private:
+        vector<uint16_t> counts_;
+        size_t entries_ = 0;
+        int since_decay_ = 0;
+    };
+
+    // ---------- Feasibility using index ----------
+    // Check teacher bounds of a single course using idx
+    static bool check_course_teacher_bounds(const SolIndex &idx, int course, const CompiledProblem &cp)
+    {
+        int cnt = idx.course_teachers[course];
+        return cnt >= cp.course_min_teachers[course] && cnt <= cp.course_max_teachers[course];
+    }
+
+    // Each teacher teaches between 1 and max_courses courses
+    static bool check_teacher_course_bounds(const SolIndex &idx, int teacher, const CompiledProblem &cp)
+    {
+        int cnt = idx.teacher_courses[teacher];
+        return cnt >= 1 && cnt <= cp.teacher_max_courses[teacher];
     }
 
-    // IsFeasibleBlock now uses the prebuilt index for O(1) lookups
-    static bool IsFeasibleBlock(const string &teacher_id,
-                                const string &course_id,
-                                const string &section_id,
-                                const string &day,
-                                const string &start_period,
-                                const OptimalSolution &sol,
+    // Can the block be placed on top of idx? The block itself must not be in idx.
+    static bool IsFeasibleBlock(int teacher,
+                                int course,
+                                int section,
+                                int day,
+                                int start_period,
                                 const SolIndex &idx,
-                                const ProblemData &data)
+                                const CompiledProblem &cp)
     {
-        // teacher exists and eligible
-        auto it_teacher = find_if(data.teachers.begin(), data.teachers.end(),
-                                  [&](const Teacher &t)
-                                  { return t.id == teacher_id; });
-        if (it_teacher == data.teachers.end())
+        // teacher eligible
+        if (!cp.eligible(teacher, course))
             return false;
-        if (find(it_teacher->eligible_courses.begin(), it_teacher->eligible_courses.end(), course_id) == it_teacher->eligible_courses.end())
+
+        int r = cp.section_required_periods[section];
+        if (start_period + r - 1 >= cp.num_periods)
             return false;
 
-        int r = get_required_periods(data, course_id, section_id);
+        // teacher slot conflict, room capacity, same-course conflict
+        int first = cp.slot(day, start_period);
+        return !any_in_run(&idx.teacher_busy[(size_t)teacher * idx.slot_words], first, r) &&
+               !any_in_run(idx.full_slots.data(), first, r) &&
+               !any_in_run(&idx.course_busy[(size_t)course * idx.slot_words], first, r);
+    }
 
-        // find start idx in periods
-        int start_idx = -1;
-        for (int m = 0; m < (int)data.classrooms.periods.size(); ++m)
-            if (data.classrooms.periods[m] == start_period)
+    // Replace the n assignments at pos[] by repl[] if the result stays feasible.
+    // On success sol/idx are updated in place and mv records how to undo it;
+    // on failure both are left untouched.
+    static bool try_apply(Schedule &sol, SolIndex &idx, const CompiledProblem &cp,
+                          Move &mv, int n, const int *pos, const Assign *repl)
+    {
+        ++mv.checks;
+        int score_before = idx.score;
+        for (int k = 0; k < n; ++k)
+            index_remove(idx, sol.assignments[pos[k]], cp);
+
+        int placed = 0;
+        bool ok = true;
+        for (int k = 0; k < n && ok; ++k)
+        {
+            const Assign &x = repl[k];
+            ok = IsFeasibleBlock(x.teacher, x.course, x.section, x.day, x.period, idx, cp);
+            if (ok)
             {
-                start_idx = m;
-                break;
+                index_add(idx, x, cp);
+                ++placed;
             }
-        if (start_idx < 0 || start_idx + r - 1 >= (int)data.classrooms.periods.size())
+        }
+        for (int k = 0; k < n && ok; ++k)
+            ok = check_course_teacher_bounds(idx, repl[k].course, cp) &&
+                 check_teacher_course_bounds(idx, repl[k].teacher, cp) &&
+                 check_teacher_course_bounds(idx, sol.assignments[pos[k]].teacher, cp);
+
+        if (!ok)
+        {
+            for (int k = 0; k < placed; ++k)
+                index_remove(idx, repl[k], cp);
+            for (int k = 0; k < n; ++k)
+                index_add(idx, sol.assignments[pos[k]], cp);
             return false;
+        }
 
-        for (int t = 0; t < r; ++t)
+        mv.n = n;
+        mv.delta = idx.score - score_before;
+        for (int k = 0; k < n; ++k)
         {
-            string period = data.classrooms.periods[start_idx + t];
-            string sk = slot_key(day, period);
+            mv.pos[k] = pos[k];
+            mv.before[k] = sol.assignments[pos[k]];
+            sol.assignments[pos[k]] = repl[k];
+        }
+        return true;
+    }
 
-            // --- teacher slot conflict (O(1)) ---
-            auto it_tb = idx.teacher_busy.find(teacher_id);
-            if (it_tb != idx.teacher_busy.end() && it_tb->second.find(sk) != it_tb->second.end())
-                return false;
+    static void undo_move(Schedule &sol, SolIndex &idx, const CompiledProblem &cp, const Move &mv)
+    {
+        for (int k = 0; k < mv.n; ++k)
+            index_remove(idx, sol.assignments[mv.pos[k]], cp);
+        for (int k = 0; k < mv.n; ++k)
+        {
+            sol.assignments[mv.pos[k]] = mv.before[k];
+            index_add(idx, mv.before[k], cp);
+        }
+    }
 
-            // --- room capacity (O(1)) ---
-            auto day_it = data.classrooms.Clm.find(day);
-            if (day_it == data.classrooms.Clm.end())
-                return false;
-            auto period_it = day_it->second.find(period);
-            if (period_it == day_it->second.end())
-                return false;
-            int cap = period_it->second;
-            int cnt = 0;
-            auto it_sc = idx.slot_count.find(sk);
-            if (it_sc != idx.slot_count.end())
-                cnt = it_sc->second;
-            if (cnt >= cap)
-                return false;
+    // ---------- Acceptance ----------
+    // Standard deviation of the last n values, updated in O(1) per push
+    class RunningWindow
+    {
+    public:
+        explicit RunningWindow(size_t n) : ring_(n, 0) {}
 
-            // --- same-course conflict: check idx.course_slot_section ---
-            auto it_cs = idx.course_slot_section.find(course_id);
-            if (it_cs != idx.course_slot_section.end())
+        void push(int v)
+        {
+            if (size_ == ring_.size())
             {
-                auto it_slot = it_cs->second.find(sk);
-                if (it_slot != it_cs->second.end() && it_slot->second != section_id)
-                    return false;
+                sum_ -= ring_[next_];
+                sum_sq_ -= (long long)ring_[next_] * ring_[next_];
             }
+            else
+                ++size_;
+            ring_[next_] = v;
+            sum_ += v;
+            sum_sq_ += (long long)v * v;
+            next_ = next_ + 1 == ring_.size() ? 0 : next_ + 1;
         }
-        return true;
-    }
 
-    // Convenience wrapper for single-period feasibility (keeps compatibility)
-    static bool IsFeasible(const string &teacher_id,
-                           const string &course_id,
-                           const string &section_id,
-                           const string &day,
-                           const string &period,
-                           const OptimalSolution &sol,
-                           const SolIndex &idx,
-                           const ProblemData &data)
+        double stddev() const
+        {
+            if (size_ == 0)
+                return 0.0;
+            // the sums are exact integers, so removing old values never drifts
+            double var = ((double)sum_sq_ - (double)sum_ * sum_ / size_) / size_;
+            return var > 0 ? sqrt(var) : 0.0;
+        }
+
+    private:
+        vector<int> ring_;
+        size_t next_ = 0;
+        size_t size_ = 0;
+        long long sum_ = 0;
+        long long sum_sq_ = 0;
+    };
+
+    // Base temperature of the search. step() runs once per iteration and
+    // restart() when the search restarts from its best schedule.
+    class CoolingSchedule
     {
-        return IsFeasibleBlock(teacher_id, course_id, section_id, day, period, sol, idx, data);
-    }
+    public:
+        virtual ~CoolingSchedule() = default;
+        virtual double temperature() const = 0;
+        virtual void step(bool accepted_any) = 0;
+        virtual void restart() {}
+    };
 
-    // ---------- Objective Evaluation ----------
-    static double compute_stddev(const vector<int> &vals)
+    // T *= alpha; alpha rises while iterations accept moves and falls otherwise
+    class GeometricCooling : public CoolingSchedule
+    {
+    public:
+        double temperature() const override { return T_; }
+
+        void step(bool accepted_any) override
+        {
+            T_ *= alpha_;
+            if (accepted_any)
+                alpha_ = min(0.995, alpha_ + 0.0006);
+            else
+                alpha_ = max(0.92, alpha_ - 0.0009);
+        }
+
+    private:
+        double T_ = 1.0;
+        double alpha_ = 0.98;
+    };
+
+    // Lundy-Mees: T <- T / (1 + beta * T), reheated to the start temperature on restarts
+    class LundyMeesCooling : public CoolingSchedule
     {
-        if (vals.empty())
-            return 0.0;
-        double mean = accumulate(vals.begin(), vals.end(), 0.0) / vals.size();
-        double s = 0.0;
-        for (double v : vals)
-            s += (v - mean) * (v - mean);
-        return sqrt(s / vals.size());
+    public:
+        double temperature() const override { return T_; }
+        void step(bool) override { T_ /= 1 + beta_ * T_; }
+        void restart() override { T_ = T0_; }
+
+    private:
+        static constexpr double T0_ = 1.0;
+        static constexpr double beta_ = 0.01;
+        double T_ = T0_;
+    };
+
+    static unique_ptr<CoolingSchedule> make_cooling(const string &name)
+    {
+        if (name == "geometric")
+            return make_unique<GeometricCooling>();
+        if (name == "lundy_mees")
+            return make_unique<LundyMeesCooling>();
+        throw invalid_argument("unknown phase3 cooling schedule: " + name);
     }
 
-    static int Evaluate(const OptimalSolution &sol, const ProblemData &data, int history_count = 0)
+    // Simulated-annealing test for a move. The temperature mixes the cooling
+    // schedule with the spread of the objectives the test was recently asked
+    // about, so it follows the scale of the instance.
+    class Acceptance
     {
-        int score = 0;
-        for (const auto &a : sol.assignments)
+    public:
+        explicit Acceptance(unique_ptr<CoolingSchedule> cooling) : cooling_(std::move(cooling)), recent_(100) {}
+
+        bool accept(int delta, int current_objective, mt19937 &rng)
         {
-            auto it_t = find_if(data.teachers.begin(), data.teachers.end(),
-                                [&](const Teacher &t)
-                                { return t.id == a.teacher_id; });
-            if (it_t != data.teachers.end())
-            {
-                auto pc_it = it_t->course_pref.find(a.course_id);
-                if (pc_it != it_t->course_pref.end())
-                    score += pc_it->second;
-                for (const auto &tp : it_t->time_pref)
-                    if (tp.day == a.day && tp.period == a.period)
-                        score += tp.score;
-            }
+            recent_.push(current_objective);
+            double adaptive_T = 0.25 * cooling_->temperature() + 0.75 * (0.01 + recent_.stddev());
+            return uniform_real_distribution<double>(0.0, 1.0)(rng) < exp(delta / adaptive_T);
         }
-        if (history_count > 3)
-            score -= (history_count - 3);
-        return score;
+
+        CoolingSchedule &cooling() { return *cooling_; }
+
+    private:
+        unique_ptr<CoolingSchedule> cooling_;
+        RunningWindow recent_;
+    };
+
+    // ---------- Objective Evaluation ----------
+    // Full recompute; the search itself only sums Move::delta
+    static int Evaluate(const Schedule &sol, const CompiledProblem &cp)
+    {
+        return (int)evaluate_objective(cp, sol.assignments).total();
+    }
+
+    // Verification mode: the Phase 2 objective and constraints recomputed for a schedule
+    static json verify_schedule(const Schedule &sol, int initial_objective, const CompiledProblem &cp)
+    {
+        ObjectiveBreakdown score = evaluate_objective(cp, sol.assignments);
+        vector<string> violations = check_constraints(cp, sol.assignments);
+        json v;
+        v["objective"] = {{"course_preference", score.course_preference},
+                          {"time_preference", score.time_preference},
+                          {"overload", score.overload},
+                          {"total", score.total()}};
+        v["initial_objective"] = initial_objective;
+        v["matches_search"] = score.total() == sol.objective_value;
+        v["feasible"] = violations.empty();
+        v["violations"] = violations;
+        return v;
+    }
+
+    // Penalty for moves that were accepted too often
+    static inline int history_penalty(int history_count)
+    {
+        return history_count > 3 ? history_count - 3 : 0;
     }
 
+#ifndef NDEBUG
+    // Debug builds: every this many iterations the incremental objective is
+    // checked against a full Evaluate()
+    const int kObjectiveCheckInterval = 64;
+#endif
+
     // ---------- Move operators (free functions) ----------
-    // Each returns pair<changed, signature-string>
-    // Note: each move builds index(cand) once and uses it to test feasibility & course bounds
+    // Each returns pair<changed, signature> (see pair_sig)
+    // Note: a successful move is applied to sol/idx in place and recorded in mv
 
-    static pair<bool, string> move_single_change(OptimalSolution &sol, const ProblemData &data)
+    static pair<bool, uint64_t> move_single_change(Schedule &sol, SolIndex &idx, const CompiledProblem &cp, Move &mv, mt19937 &rng)
     {
         if (sol.assignments.empty())
-            return {false, ""};
+            return {false, 0};
         uniform_int_distribution<int> dist(0, (int)sol.assignments.size() - 1);
         int idx_assign = dist(rng);
-        auto &a = sol.assignments[idx_assign];
+        const Assign a = sol.assignments[idx_assign];
 
-        // find course object
-        auto it_course = find_if(data.courses.begin(), data.courses.end(),
-                                 [&](const Course &c)
-                                 { return c.id == a.course_id; });
-        if (it_course == data.courses.end() || it_course->Ij.empty())
-            return {false, ""};
-        const auto &course = *it_course;
+        const auto &Ij = cp.course_eligible_teachers[a.course];
+        if (Ij.empty())
+            return {false, 0};
 
         // try teacher change
-        uniform_int_distribution<int> tdist(0, (int)course.Ij.size() - 1);
-        string new_teacher = course.Ij[tdist(rng)];
-        if (new_teacher != a.teacher_id)
-        {
-            OptimalSolution cand = sol;
-            cand.assignments[idx_assign].teacher_id = new_teacher;
-            SolIndex idx = build_index(cand);
-            if (!check_course_teacher_bounds(idx, data))
-                ; // reject due to teacher bounds
-            else if (IsFeasible(new_teacher, a.course_id, a.section_id, a.day, a.period, cand, idx, data))
-            {
-                OptimalSolution::Assignment old = a;
-                a.teacher_id = new_teacher;
-                return {true, pair_sig(old, a)};
-            }
+        uniform_int_distribution<int> tdist(0, (int)Ij.size() - 1);
+        int new_teacher = Ij[tdist(rng)];
+        if (new_teacher != a.teacher)
+        {
+            Assign nw = a;
+            nw.teacher = new_teacher;
+            if (try_apply(sol, idx, cp, mv, 1, &idx_assign, &nw))
+                return {true, pair_sig(a, nw)};
         }
 
         // try relocate (few attempts)
-        uniform_int_distribution<int> ldist(0, (int)data.classrooms.days.size() - 1);
-        uniform_int_distribution<int> pdist(0, (int)data.classrooms.periods.size() - 1);
+        uniform_int_distribution<int> ldist(0, cp.num_days - 1);
+        uniform_int_distribution<int> pdist(0, cp.num_periods - 1);
         for (int t = 0; t < 6; ++t)
         {
-            string new_day = data.classrooms.days[ldist(rng)];
-            string new_period = data.classrooms.periods[pdist(rng)];
+            int new_day = ldist(rng);
+            int new_period = pdist(rng);
             if (new_day == a.day && new_period == a.period)
                 continue;
-            OptimalSolution cand = sol;
-            cand.assignments[idx_assign].day = new_day;
-            cand.assignments[idx_assign].period = new_period;
-            SolIndex idx = build_index(cand);
-            if (!check_course_teacher_bounds(idx, data))
-                continue;
-            if (IsFeasible(a.teacher_id, a.course_id, a.section_id, new_day, new_period, cand, idx, data))
-            {
-                OptimalSolution::Assignment old = a;
-                a.day = new_day;
-                a.period = new_period;
-                return {true, pair_sig(old, a)};
-            }
+            Assign nw = a;
+            nw.day = new_day;
+            nw.period = new_period;
+            if (try_apply(sol, idx, cp, mv, 1, &idx_assign, &nw))
+                return {true, pair_sig(a, nw)};
         }
-        return {false, ""};
+        return {false, 0};
     }
 
-    static pair<bool, string> move_teacher_swap(OptimalSolution &sol, const ProblemData &data)
+    static pair<bool, uint64_t> move_teacher_swap(Schedule &sol, SolIndex &idx, const CompiledProblem &cp, Move &mv, mt19937 &rng)
     {
         if (sol.assignments.size() < 2)
-            return {false, ""};
+            return {false, 0};
         uniform_int_distribution<int> d(0, (int)sol.assignments.size() - 1);
         int i = d(rng), j = d(rng);
         if (i == j)
-            return {false, ""};
-        auto &A = sol.assignments[i];
-        auto &B = sol.assignments[j];
-        if (A.teacher_id == B.teacher_id)
-            return {false, ""};
-
-        OptimalSolution cand = sol;
-        swap(cand.assignments[i].teacher_id, cand.assignments[j].teacher_id);
-        SolIndex idx = build_index(cand);
-        if (!check_course_teacher_bounds(idx, data))
-            return {false, ""};
-
-        if (IsFeasible(cand.assignments[i].teacher_id, A.course_id, A.section_id, A.day, A.period, cand, idx, data) &&
-            IsFeasible(cand.assignments[j].teacher_id, B.course_id, B.section_id, B.day, B.period, cand, idx, data))
-        {
-            OptimalSolution::Assignment oldA = A, oldB = B;
-            swap(A.teacher_id, B.teacher_id);
-            return {true, pair_sig(oldA, oldB)};
-        }
-        return {false, ""};
+            return {false, 0};
+        const Assign A = sol.assignments[i];
+        const Assign B = sol.assignments[j];
+        if (A.teacher == B.teacher)
+            return {false, 0};
+
+        int pos[2] = {i, j};
+        Assign repl[2] = {A, B};
+        swap(repl[0].teacher, repl[1].teacher);
+        if (try_apply(sol, idx, cp, mv, 2, pos, repl))
+            return {true, pair_sig(A, B)};
+        return {false, 0};
     }
 
-    static pair<bool, string> move_pair_swap(OptimalSolution &sol, const ProblemData &data)
+    static pair<bool, uint64_t> move_pair_swap(Schedule &sol, SolIndex &idx, const CompiledProblem &cp, Move &mv, mt19937 &rng)
     {
         if (sol.assignments.size() < 2)
-            return {false, ""};
+            return {false, 0};
         uniform_int_distribution<int> d(0, (int)sol.assignments.size() - 1);
         int i = d(rng), j = d(rng);
         if (i == j)
-            return {false, ""};
-        auto a = sol.assignments[i];
-        auto b = sol.assignments[j];
+            return {false, 0};
+        const Assign a = sol.assignments[i];
+        const Assign b = sol.assignments[j];
 
-        // simulate swap entire (teacher+slot)
-        OptimalSolution cand = sol;
+        // swap entire (teacher+slot)
+        int pos[2] = {i, j};
+        Assign repl[2] = {a, b};
         // place b into a's slot
-        cand.assignments[i].teacher_id = b.teacher_id;
-        cand.assignments[i].day = b.day;
-        cand.assignments[i].period = b.period;
+        repl[0].teacher = b.teacher;
+        repl[0].day = b.day;
+        repl[0].period = b.period;
         // place a into b's slot
-        cand.assignments[j].teacher_id = a.teacher_id;
-        cand.assignments[j].day = a.day;
-        cand.assignments[j].period = a.period;
-
-        SolIndex idx = build_index(cand);
-        if (!check_course_teacher_bounds(idx, data))
-            return {false, ""};
+        repl[1].teacher = a.teacher;
+        repl[1].day = a.day;
+        repl[1].period = a.period;
 
-        if (IsFeasible(cand.assignments[i].teacher_id, a.course_id, a.section_id, cand.assignments[i].day, cand.assignments[i].period, cand, idx, data) &&
-            IsFeasible(cand.assignments[j].teacher_id, b.course_id, b.section_id, cand.assignments[j].day, cand.assignments[j].period, cand, idx, data))
-        {
-            swap(sol.assignments[i].teacher_id, sol.assignments[j].teacher_id);
-            swap(sol.assignments[i].day, sol.assignments[j].day);
-            swap(sol.assignments[i].period, sol.assignments[j].period);
+        if (try_apply(sol, idx, cp, mv, 2, pos, repl))
             return {true, pair_sig(a, b)};
-        }
-        return {false, ""};
+        return {false, 0};
     }
 
-    static pair<bool, string> move_block_relocate(OptimalSolution &sol, const ProblemData &data)
+    static pair<bool, uint64_t> move_block_relocate(Schedule &sol, SolIndex &idx, const CompiledProblem &cp, Move &mv, mt19937 &rng)
     {
         if (sol.assignments.empty())
-            return {false, ""};
+            return {false, 0};
         uniform_int_distribution<int> d(0, (int)sol.assignments.size() - 1);
         int idx_assign = d(rng);
-        auto &a = sol.assignments[idx_assign];
+        const Assign a = sol.assignments[idx_assign];
         int attempts = 6;
-        uniform_int_distribution<int> ldist(0, (int)data.classrooms.days.size() - 1);
-        uniform_int_distribution<int> pdist(0, (int)data.classrooms.periods.size() - 1);
+        uniform_int_distribution<int> ldist(0, cp.num_days - 1);
+        uniform_int_distribution<int> pdist(0, cp.num_periods - 1);
         for (int t = 0; t < attempts; ++t)
         {
-            string nd = data.classrooms.days[ldist(rng)];
-            string np = data.classrooms.periods[pdist(rng)];
+            int nd = ldist(rng);
+            int np = pdist(rng);
             if (nd == a.day && np == a.period)
                 continue;
-            OptimalSolution cand = sol;
-            cand.assignments[idx_assign].day = nd;
-            cand.assignments[idx_assign].period = np;
-            SolIndex idx = build_index(cand);
-            if (!check_course_teacher_bounds(idx, data))
-                continue;
-            if (IsFeasibleBlock(a.teacher_id, a.course_id, a.section_id, nd, np, cand, idx, data))
-            {
-                OptimalSolution::Assignment old = a;
-                a.day = nd;
-                a.period = np;
-                return {true, pair_sig(old, a)};
-            }
+            Assign nw = a;
+            nw.day = nd;
+            nw.period = np;
+            if (try_apply(sol, idx, cp, mv, 1, &idx_assign, &nw))
+                return {true, pair_sig(a, nw)};
         }
-        return {false, ""};
+        return {false, 0};
     }
 
-    static pair<bool, string> move_block_swap(OptimalSolution &sol, const ProblemData &data)
+    static pair<bool, uint64_t> move_block_swap(Schedule &sol, SolIndex &idx, const CompiledProblem &cp, Move &mv, mt19937 &rng)
     {
         if (sol.assignments.size() < 2)
-            return {false, ""};
+            return {false, 0};
         uniform_int_distribution<int> d(0, (int)sol.assignments.size() - 1);
         int i = d(rng), j = d(rng);
         if (i == j)
-            return {false, ""};
-        auto A = sol.assignments[i];
-        auto B = sol.assignments[j];
-
-        OptimalSolution cand = sol;
-        cand.assignments[i].day = B.day;
-        cand.assignments[i].period = B.period;
-        cand.assignments[i].teacher_id = B.teacher_id;
-        cand.assignments[j].day = A.day;
-        cand.assignments[j].period = A.period;
-        cand.assignments[j].teacher_id = A.teacher_id;
-
-        SolIndex idx = build_index(cand);
-        if (!check_course_teacher_bounds(idx, data))
-            return {false, ""};
-
-        if (IsFeasibleBlock(cand.assignments[i].teacher_id, A.course_id, A.section_id, cand.assignments[i].day, cand.assignments[i].period, cand, idx, data) &&
-            IsFeasibleBlock(cand.assignments[j].teacher_id, B.course_id, B.section_id, cand.assignments[j].day, cand.assignments[j].period, cand, idx, data))
-        {
-            swap(sol.assignments[i].day, sol.assignments[j].day);
-            swap(sol.assignments[i].period, sol.assignments[j].period);
-            swap(sol.assignments[i].teacher_id, sol.assignments[j].teacher_id);
+            return {false, 0};
+        const Assign A = sol.assignments[i];
+        const Assign B = sol.assignments[j];
+
+        int pos[2] = {i, j};
+        Assign repl[2] = {A, B};
+        repl[0].day = B.day;
+        repl[0].period = B.period;
+        repl[0].teacher = B.teacher;
+        repl[1].day = A.day;
+        repl[1].period = A.period;
+        repl[1].teacher = A.teacher;
+
+        if (try_apply(sol, idx, cp, mv, 2, pos, repl))
             return {true, pair_sig(A, B)};
+        return {false, 0};
+    }
+
+    // ---------- Conversion between string and index form ----------
+    static Schedule to_schedule(const InitialSolution &init, const CompiledProblem &cp)
+    {
+        Schedule sol;
+        try
+        {
+            sol.assignments = to_placements(cp, init.assignments);
         }
-        return {false, ""};
+        catch (const runtime_error &ex)
+        {
+            throw runtime_error(string("Phase3: ") + ex.what());
+        }
+        return sol;
     }
 
-} // anonymous namespace
+    static OptimalSolution to_optimal_solution(const Schedule &sol, const CompiledProblem &cp)
+    {
+        OptimalSolution out;
+        out.assignments.reserve(sol.assignments.size());
+        for (const auto &a : sol.assignments)
+            out.assignments.push_back({cp.teacher_ids[a.teacher], cp.course_ids[a.course], cp.section_ids[a.section],
+                                       cp.days[a.day], cp.periods[a.period]});
+        out.objective_value = sol.objective_value;
+        return out;
+    }
 
-// ---------- Main Phase3 ----------
-OptimalSolution find_optimal_solution(const ProblemData &data, const InitialSolution &initial)
-{
-    OptimalSolution current = initial;
-    OptimalSolution temp = initial;
-    OptimalSolution best = initial;
+    // ---------- Best-solution exchange between parallel searches ----------
+    // Workers meet every exchange_interval iterations. The barrier makes the
+    // exchange independent of thread timing, so seeded runs stay reproducible.
+    class Exchange
+    {
+    public:
+        explicit Exchange(int workers) : workers_(workers), waiting_for_(workers), participants_(workers) {}
+
+        int workers() const { return workers_; }
+
+        // Publish best and wait for the other workers. If one of them has a
+        // better schedule (ties go to the lowest worker id), copy it into best
+        // and return true; best keeps its storage, so this does not allocate.
+        bool share(int worker, Schedule &best)
+        {
+            unique_lock<mutex> lock(m_);
+            offer(worker, best);
+            size_t gen = generation_;
+            if (--waiting_for_ == 0)
+                release();
+            else
+                cv_.wait(lock, [&]
+                         { return generation_ != gen; });
+            if (published_.objective_value <= best.objective_value)
+                return false;
+            best = published_;
+            return true;
+        }
+
+        // A worker that has finished no longer takes part in exchanges
+        void leave(int worker, const Schedule &best)
+        {
+            lock_guard<mutex> lock(m_);
+            offer(worker, best);
+            --participants_;
+            if (--waiting_for_ == 0)
+                release();
+        }
+
+        // A worker whose search threw leaves without offering a schedule, so
+        // the others are not left waiting for it at the barrier
+        void abandon()
+        {
+            lock_guard<mutex> lock(m_);
+            --participants_;
+            if (--waiting_for_ == 0)
+                release();
+        }
+
+        const Schedule &result() const { return best_; }
+
+    private:
+        void offer(int worker, const Schedule &sol)
+        {
+            if (best_worker_ < 0 || sol.objective_value > best_.objective_value ||
+                (sol.objective_value == best_.objective_value && worker < best_worker_))
+            {
+                best_ = sol;
+                best_worker_ = worker;
+            }
+        }
+
+        void release()
+        {
+            published_ = best_;
+            waiting_for_ = participants_;
+            ++generation_;
+            cv_.notify_all();
+        }
+
+        const int workers_;
+        mutex m_;
+        condition_variable cv_;
+        int waiting_for_;
+        int participants_;
+        size_t generation_ = 0;
+        Schedule best_;
+        Schedule published_;
+        int best_worker_ = -1;
+    };
+
+    static uint64_t worker_seed(const Phase3Options &opts, int worker)
+    {
+        if (!opts.has_seed)
+            return random_device{}() ^ (uint64_t)chrono::steady_clock::now().time_since_epoch().count();
+        seed_seq seq{(uint32_t)opts.seed, (uint32_t)(opts.seed >> 32), (uint32_t)worker};
+        uint32_t out[2];
+        seq.generate(out, out + 2);
+        return ((uint64_t)out[0] << 32) | out[1];
+    }
+
+    enum class StopReason
+    {
+        Iterations,
+        TimeLimit,
+        Stalled,
+        Cancelled
+    };
+
+    // Limits shared by all searches of one Phase 3 run
+    struct SearchBudget
+    {
+        bool has_deadline = false;
+        chrono::steady_clock::time_point deadline;
+        const SolveControl *ctl = nullptr;
+        atomic<bool> out_of_time{false};
+        atomic<bool> failed{false}; // a search threw, the others stop as if cancelled
+
+        // Iterations while the budget lasts, otherwise why it ran out
+        bool expired(StopReason &reason)
+        {
+            if (ctl->cancelled() || failed.load(memory_order_relaxed))
+            {
+                reason = StopReason::Cancelled;
+                return true;
+            }
+            if (!out_of_time.load(memory_order_relaxed) && has_deadline && chrono::steady_clock::now() >= deadline)
+                out_of_time.store(true, memory_order_relaxed);
+            if (out_of_time.load(memory_order_relaxed))
+            {
+                reason = StopReason::TimeLimit;
+                return true;
+            }
+            return false;
+        }
+    };
+
+    static const char *stop_reason_name(StopReason r)
+    {
+        switch (r)
+        {
+        case StopReason::TimeLimit:
+            return "time_limit";
+        case StopReason::Stalled:
+            return "stalled";
+        case StopReason::Cancelled:
+            return "cancelled";
+        default:
+            return "iterations";
+        }
+    }
+
+    // Neighborhood names in run_search order, for SolveStats
+    const char *const kNeighborhoodNames[] = {"single_change", "teacher_swap", "pair_swap", "block_relocate", "block_swap"};
 
-    current.objective_value = Evaluate(current, data);
-    temp.objective_value = current.objective_value;
-    best.objective_value = current.objective_value;
+    // Roulette-wheel choice of the move operator. Every segment the weight of
+    // each operator tried moves towards its yield: accepted moves plus objective
+    // gained, per feasibility check spent. Checks stand in for time (they are
+    // what an operator costs) and keep seeded runs reproducible. Operators that
+    // mostly fail feasibility lose their share but never drop below min_weight.
+    class OperatorSelector
+    {
+    public:
+        explicit OperatorSelector(int n) : weights_(n, 1.0), segment_(n) {}
+
+        int pick(mt19937 &rng) const
+        {
+            double total = 0;
+            for (double w : weights_)
+                total += w;
+            double r = uniform_real_distribution<double>(0.0, total)(rng);
+            for (int k = 0; k + 1 < (int)weights_.size(); ++k)
+            {
+                if (r < weights_[k])
+                    return k;
+                r -= weights_[k];
+            }
+            return (int)weights_.size() - 1;
+        }
+
+        void record(int op, const Move &mv, bool accepted)
+        {
+            Segment &s = segment_[op];
+            s.checks += max(1, mv.checks);
+            if (accepted)
+            {
+                s.accepted += 1;
+                s.gain += max(0, mv.delta);
+            }
+        }
 
-    // Tabu + history
-    deque<string> tabu_q;
-    unordered_set<string> tabu_set;
-    size_t tabu_tenure = 150; // tuneable
-    unordered_map<string, int> history_count;
+        // Fold the segment into the weights and start a new one
+        void update()
+        {
+            double best = 0;
+            for (const auto &s : segment_)
+                if (s.checks > 0)
+                    best = max(best, s.yield());
+            for (size_t k = 0; k < weights_.size(); ++k)
+            {
+                if (segment_[k].checks == 0)
+                    continue;
+                double score = best > 0 ? segment_[k].yield() / best : 0.0;
+                weights_[k] = max(min_weight, (1 - reaction) * weights_[k] + reaction * score);
+            }
+            fill(segment_.begin(), segment_.end(), Segment());
+        }
 
-    // Neighborhoods ordered by increasing strength
-    using MoveFn = pair<bool, string> (*)(OptimalSolution &, const ProblemData &);
-    vector<MoveFn> neighborhoods = {
-        &move_single_change,
-        &move_teacher_swap,
-        &move_pair_swap,
-        &move_block_relocate,
-        &move_block_swap};
+        const vector<double> &weights() const { return weights_; }
 
-    // SA/VNS params
-    double T = 1.0;
-    double alpha = 0.98;
-    int max_iterations = 1200;
-    int moves_per_nb = 40;
-    int limit_no_improv = 300;
+    private:
+        struct Segment
+        {
+            long long checks = 0;
+            long long accepted = 0;
+            long long gain = 0;
+            double yield() const { return (accepted + gain) / (double)checks; }
+        };
+
+        static constexpr double reaction = 0.3;    // share of the new segment in a weight
+        static constexpr double min_weight = 0.05; // every operator keeps being sampled
+        vector<double> weights_;
+        vector<Segment> segment_;
+    };
 
-    deque<int> recent_objs;
-    int numb_iter_no_improv = 0;
+    struct SearchResult
+    {
+        StopReason reason = StopReason::Iterations;
+        int iterations = 0;
+        vector<SolveStats::Moves> moves; // per neighborhood, then the diversification shakes
+        vector<double> weights;          // final operator weights, per neighborhood
+        long long tabu_hits = 0;
+        long long restarts = 0;
+    };
 
-    for (int iter = 0; iter < max_iterations; ++iter)
+    // Forwards improved best schedules to SolveControl::on_incumbent, at most
+    // once per interval; finish() always reports the final best.
+    class IncumbentReporter
     {
-        bool any_improved = false;
+    public:
+        IncumbentReporter(const CompiledProblem &cp, const SolveControl &ctl, double interval_seconds)
+            : cp_(cp), ctl_(ctl), start_(chrono::steady_clock::now()),
+              interval_(chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(interval_seconds))),
+              next_ticks_(start_.time_since_epoch().count()) {}
+
+        void offer(const Schedule &best)
+        {
+            if (!ctl_.on_incumbent)
+                return;
+            auto now = chrono::steady_clock::now();
+            if (now.time_since_epoch().count() < next_ticks_.load(memory_order_relaxed))
+                return;
+            lock_guard<mutex> lock(m_);
+            if (best.objective_value <= reported_)
+                return;
+            next_ticks_.store((now + interval_).time_since_epoch().count(), memory_order_relaxed);
+            report(best, now);
+        }
+
+        void finish(const Schedule &best)
+        {
+            if (!ctl_.on_incumbent)
+                return;
+            lock_guard<mutex> lock(m_);
+            if (best.objective_value > reported_)
+                report(best, chrono::steady_clock::now());
+        }
+
+    private:
+        void report(const Schedule &best, chrono::steady_clock::time_point now)
+        {
+            IncumbentUpdate update;
+            update.phase = "phase3";
+            update.objective_value = best.objective_value;
+            update.elapsed_seconds = chrono::duration<double>(now - start_).count();
+            update.assignments = assignments_to_json(to_optimal_solution(best, cp_).assignments);
+            ctl_.on_incumbent(update);
+            reported_ = best.objective_value;
+        }
+
+        const CompiledProblem &cp_;
+        const SolveControl &ctl_;
+        chrono::steady_clock::time_point start_;
+        chrono::steady_clock::duration interval_;
+        atomic<long long> next_ticks_;
+        mutex m_;
+        int reported_ = numeric_limits<int>::min();
+    };
 
-        for (size_t nb = 0; nb < neighborhoods.size(); ++nb)
+    // One SA/VNS/tabu search; all of its state is local to the calling thread
+    static SearchResult run_search(const CompiledProblem &cp, const Schedule &initial, const Phase3Options &opts,
+                                   int worker, unique_ptr<CoolingSchedule> cooling, Exchange &exchange,
+                                   SearchBudget &budget, IncumbentReporter &reporter)
+    {
+        mt19937 rng((mt19937::result_type)worker_seed(opts, worker));
+        Schedule current = initial;
+        SolIndex idx;
+        build_index(idx, current, cp);
+        Schedule best = current;
+
+        // Tabu + history
+        TabuList tabu(150); // tenure, tuneable
+        MoveFrequency history;
+
+        // Move operators, picked by OperatorSelector (names in kNeighborhoodNames)
+        using MoveFn = pair<bool, uint64_t> (*)(Schedule &, SolIndex &, const CompiledProblem &, Move &, mt19937 &);
+        vector<MoveFn> neighborhoods = {
+            &move_single_change,
+            &move_teacher_swap,
+            &move_pair_swap,
+            &move_block_relocate,
+            &move_block_swap};
+
+        // SA params; an iteration ends at the first accepted move
+        Acceptance acceptance(std::move(cooling));
+        int moves_per_iteration = 200;
+        int segment_iterations = 25; // operator weights are updated this often
+        int limit_no_improv = 300;
+        OperatorSelector selector((int)neighborhoods.size());
+
+        int numb_iter_no_improv = 0;
+        int last_improvement = 0;
+
+        SearchResult result;
+        result.moves.resize(neighborhoods.size() + 1);
+        SolveStats::Moves &shake_moves = result.moves.back();
+        int iter = 0;
+        for (; iter < opts.max_iterations; ++iter)
         {
-            bool improved_in_nb = false;
+            if (budget.expired(result.reason))
+                break;
+
+            bool any_improved = false;
 
-            for (int mv = 0; mv < moves_per_nb; ++mv)
+            for (int mv = 0; mv < moves_per_iteration; ++mv)
             {
-                // Prepare candidate copy and try a move
-                OptimalSolution cand = current;
-                auto res = neighborhoods[nb](cand, data);
+                // Apply a move in place; it is undone below unless accepted
+                int nb = selector.pick(rng);
+                SolveStats::Moves &nb_moves = result.moves[nb];
+                ++nb_moves.tried;
+                Move move;
+                auto res = neighborhoods[nb](current, idx, cp, move, rng);
                 if (!res.first)
+                {
+                    selector.record(nb, move, false);
                     continue;
-                string sig = res.second;
+                }
+                uint64_t sig = res.second;
+                ++nb_moves.feasible;
+
+                int cand_score = current.objective_value + move.delta;
 
                 // check tabu
-                if (!sig.empty() && tabu_set.find(sig) != tabu_set.end())
+                if (tabu.contains(sig) && cand_score <= best.objective_value)
                 {
-                    int cand_score = Evaluate(cand, data, history_count[sig]);
-                    if (cand_score <= best.objective_value)
-                        continue; // reject unless aspiration
+                    ++result.tabu_hits;
+                    selector.record(nb, move, false);
+                    undo_move(current, idx, cp, move);
+                    continue; // reject unless aspiration
                 }
 
-                int cand_score = Evaluate(cand, data, history_count[sig]);
-                int delta = cand_score - temp.objective_value;
+                int delta = move.delta - history_penalty(history.count(sig));
 
-                bool accept = false;
-                if (delta >= 0)
-                    accept = true;
-                else
+                bool accept = delta >= 0 || acceptance.accept(delta, current.objective_value, rng);
+
+                selector.record(nb, move, accept);
+                if (!accept)
                 {
-                    recent_objs.push_back(temp.objective_value);
-                    if (recent_objs.size() > 100)
-                        recent_objs.pop_front();
-                    vector<int> tmp(recent_objs.begin(), recent_objs.end());
-                    double sigma = compute_stddev(tmp);
-                    double adaptive_T = 0.25 * T + 0.75 * (0.01 + sigma);
-                    uniform_real_distribution<double> u(0.0, 1.0);
-                    double prob = exp(delta / adaptive_T);
-                    if (u(rng) < prob)
-                        accept = true;
+                    undo_move(current, idx, cp, move);
+                    continue;
                 }
 
-                if (accept)
+                current.objective_value = cand_score;
+                ++nb_moves.accepted;
+
+                history.add(sig);
+                tabu.push(sig);
+
+                if (cand_score > best.objective_value)
                 {
-                    current = cand;
-                    temp = cand;
-                    temp.objective_value = cand_score;
+                    best = current;
+                    numb_iter_no_improv = 0;
+                    last_improvement = iter;
+                    ++nb_moves.improved;
+                    reporter.offer(best);
+                }
+                else
+                    ++numb_iter_no_improv;
 
-                    if (!sig.empty())
+                any_improved = true;
+                break;
+            } // moves
+
+            if ((iter + 1) % segment_iterations == 0)
+                selector.update();
+
+            if (!any_improved)
+            {
+                // diversification: random shakes
+                int shakes = 4;
+                for (int s = 0; s < shakes; ++s)
+                {
+                    Move move;
+                    pair<bool, uint64_t> res = move_block_relocate(current, idx, cp, move, rng);
+                    if (!res.first)
+                        res = move_teacher_swap(current, idx, cp, move, rng);
+                    if (!res.first)
+                        res = move_pair_swap(current, idx, cp, move, rng);
+                    ++shake_moves.tried;
+                    if (!res.first)
+                        continue;
+                    uint64_t sig = res.second;
+                    ++shake_moves.feasible;
+
+                    int cand_score = current.objective_value + move.delta;
+                    int delta = move.delta - history_penalty(history.count(sig));
+
+                    if (acceptance.accept(delta, current.objective_value, rng))
                     {
-                        history_count[sig] += 1;
-                        tabu_q.push_back(sig);
-                        tabu_set.insert(sig);
-                        if (tabu_q.size() > tabu_tenure)
+                        current.objective_value = cand_score;
+                        ++shake_moves.accepted;
+                        history.add(sig);
+                        tabu.push(sig);
+                        if (cand_score > best.objective_value)
                         {
-                            string old = tabu_q.front();
-                            tabu_q.pop_front();
-                            tabu_set.erase(old);
+                            best = current;
+                            numb_iter_no_improv = 0;
+                            last_improvement = iter;
+                            ++shake_moves.improved;
+                            reporter.offer(best);
                         }
+                        else
+                            ++numb_iter_no_improv;
+                        break;
                     }
+                    undo_move(current, idx, cp, move);
+                }
+            }
 
-                    if (cand_score > best.objective_value)
-                    {
-                        best = cand;
-                        best.objective_value = cand_score;
-                        numb_iter_no_improv = 0;
-                    }
-                    else
-                        ++numb_iter_no_improv;
+            acceptance.cooling().step(any_improved);
 
-                    improved_in_nb = true;
-                    any_improved = true;
-                    // intensify: restart from smallest neighborhood
-                    nb = 0;
-                    break;
+            // restart if stuck
+            if (numb_iter_no_improv > limit_no_improv)
+            {
+                ++result.restarts;
+                acceptance.cooling().restart();
+                current = best;
+                numb_iter_no_improv = 0;
+                shuffle(current.assignments.begin(), current.assignments.end(), rng);
+                build_index(idx, current, cp);
+                // small shake
+                for (int k = 0; k < (int)current.assignments.size() / 12; ++k)
+                {
+                    Move move;
+                    if (move_single_change(current, idx, cp, move, rng).first)
+                        current.objective_value += move.delta;
                 }
-            } // moves per neighborhood
+            }
 
-            if (!improved_in_nb)
+#ifndef NDEBUG
+            if (iter % kObjectiveCheckInterval == 0)
             {
-                // go to next neighborhood (diversify)
-                continue;
+                assert(current.objective_value == Evaluate(current, cp));
+                assert(best.objective_value == Evaluate(best, cp));
             }
-        } // neighborhoods
+#endif
 
-        if (!any_improved)
-        {
-            // diversification: random shakes
-            int shakes = 4;
-            for (int s = 0; s < shakes; ++s)
+            // adopt the best schedule of the other searches if it beats ours
+            if (exchange.workers() > 1 && opts.exchange_interval > 0 && (iter + 1) % opts.exchange_interval == 0)
             {
-                OptimalSolution cand = current;
-                pair<bool, string> res = move_block_relocate(cand, data);
-                if (!res.first)
-                    res = move_teacher_swap(cand, data);
-                if (!res.first)
-                    res = move_pair_swap(cand, data);
-                if (!res.first)
-                    continue;
-                string sig = res.second;
-
-                int cand_score = Evaluate(cand, data, history_count[sig]);
-
-                uniform_real_distribution<double> u(0.0, 1.0);
-                recent_objs.push_back(temp.objective_value);
-                if (recent_objs.size() > 100)
-                    recent_objs.pop_front();
-                vector<int> tmp(recent_objs.begin(), recent_objs.end());
-                double sigma = compute_stddev(tmp);
-                double adaptive_T = 0.25 * T + 0.75 * (0.01 + sigma);
-                double prob = exp((cand_score - temp.objective_value) / adaptive_T);
-                if (u(rng) < prob)
+                if (exchange.share(worker, best))
                 {
-                    current = cand;
-                    temp = cand;
-                    temp.objective_value = cand_score;
-                    if (!sig.empty())
-                    {
-                        history_count[sig] += 1;
-                        tabu_q.push_back(sig);
-                        tabu_set.insert(sig);
-                        if (tabu_q.size() > tabu_tenure)
-                        {
-                            string old = tabu_q.front();
-                            tabu_q.pop_front();
-                            tabu_set.erase(old);
-                        }
-                    }
-                    if (cand_score > best.objective_value)
-                    {
-                        best = cand;
-                        best.objective_value = cand_score;
-                        numb_iter_no_improv = 0;
-                    }
-                    else
-                        ++numb_iter_no_improv;
-                    break;
+                    current = best;
+                    build_index(idx, current, cp);
+                    numb_iter_no_improv = 0;
+                    last_improvement = iter;
                 }
             }
+
+            // convergence: best has not moved for stall_iterations
+            if (opts.stall_iterations > 0 && iter - last_improvement >= opts.stall_iterations)
+            {
+                result.reason = StopReason::Stalled;
+                ++iter;
+                break;
+            }
+
+            if (worker == 0 && iter % 50 == 0)
+            {
+                cout << "[Phase3] Iter " << iter
+                     << ", Best " << best.objective_value
+                     << ", Temp " << acceptance.cooling().temperature()
+                     << ", Tabu " << tabu.size()
+                     << ", HistoryEntries " << history.entries()
+                     << "\n";
+            }
+        } // main loop
+
+        result.iterations = iter;
+        result.weights = selector.weights();
+        exchange.leave(worker, best); // last: nothing may throw once the worker has left
+        return result;
+    }
+
+} // anonymous namespace
+
+// ---------- Main Phase3 ----------
+OptimalSolution find_optimal_solution(const ProblemData &data, const InitialSolution &initial, const Phase3Options &opts,
+                                      const SolveControl &ctl)
+{
+    const CompiledProblem &cp = data.compiled;
+    auto search_start = chrono::steady_clock::now();
+    Schedule start = to_schedule(initial, cp);
+    start.objective_value = Evaluate(start, cp);
+
+    SearchBudget budget;
+    budget.ctl = &ctl;
+    if (opts.time_limit_seconds > 0)
+    {
+        budget.has_deadline = true;
+        budget.deadline = chrono::steady_clock::now() +
+                          chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(opts.time_limit_seconds));
+    }
+
+    int workers = solver_threads(opts.threads);
+    // built here so an unknown name throws to the caller, not inside a search thread
+    vector<unique_ptr<CoolingSchedule>> coolings;
+    for (int w = 0; w < workers; ++w)
+        coolings.push_back(make_cooling(opts.cooling));
+
+    Exchange exchange(workers);
+    IncumbentReporter reporter(cp, ctl, opts.progress_interval_seconds);
+    vector<SearchResult> results(workers);
+    vector<exception_ptr> errors(workers);
+    auto search = [&](int w)
+    {
+        try
+        {
+            results[w] = run_search(cp, start, opts, w, std::move(coolings[w]), exchange, budget, reporter);
         }
+        catch (...)
+        {
+            errors[w] = current_exception();
+            budget.failed.store(true, memory_order_relaxed);
+            exchange.abandon();
+        }
+    };
+    vector<thread> pool;
+    for (int w = 1; w < workers; ++w)
+        pool.emplace_back(search, w);
+    search(0);
+    for (auto &t : pool)
+        t.join();
+    for (const auto &error : errors)
+        if (error)
+            rethrow_exception(error);
+
+    // cancelled/time_limit if any search was cut short, stalled only if every search converged
+    StopReason reason = StopReason::Stalled;
+    int iterations = 0;
+    for (const auto &r : results)
+    {
+        if (r.reason == StopReason::Cancelled || (r.reason == StopReason::TimeLimit && reason != StopReason::Cancelled))
+            reason = r.reason;
+        else if (r.reason == StopReason::Iterations && reason == StopReason::Stalled)
+            reason = StopReason::Iterations;
+        iterations = max(iterations, r.iterations);
+    }
 
-        // cooling & adapt alpha
-        T *= alpha;
-        if (any_improved)
-            alpha = min(0.995, alpha + 0.0006);
-        else
-            alpha = max(0.92, alpha - 0.0009);
+    const Schedule &best = exchange.result();
+    reporter.finish(best);
+    cout << "[Phase3] Finished (" << workers << " search" << (workers > 1 ? "es" : "") << ", "
+         << iterations << " iterations, stop: " << stop_reason_name(reason) << "). Best objective: "
+         << best.objective_value << ", Total assignments: " << best.assignments.size() << "\n";
 
-        // restart if stuck
-        if (numb_iter_no_improv > limit_no_improv)
+    if (ctl.stats)
+    {
+        for (const auto &r : results)
         {
-            current = best;
-            temp = best;
-            numb_iter_no_improv = 0;
-            shuffle(current.assignments.begin(), current.assignments.end(), rng);
-            // small shake
-            for (int k = 0; k < (int)current.assignments.size() / 12; ++k)
-                move_single_change(current, data);
+            for (size_t nb = 0; nb < r.moves.size(); ++nb)
+                ctl.stats->add_moves(nb < size(kNeighborhoodNames) ? kNeighborhoodNames[nb] : "shake", r.moves[nb]);
+            ctl.stats->add_phase3(r.tabu_hits, r.restarts);
         }
+        ctl.stats->add_duration("phase3_search", chrono::duration<double>(chrono::steady_clock::now() - search_start).count());
+    }
 
-        if (iter % 50 == 0)
+    // operator yield, summed over the searches (weights averaged)
+    for (size_t nb = 0; nb < size(kNeighborhoodNames); ++nb)
+    {
+        SolveStats::Moves total;
+        double weight = 0;
+        for (const auto &r : results)
         {
-            cout << "[Phase3] Iter " << iter
-                 << ", Best " << best.objective_value
-                 << ", Temp " << T
-                 << ", Tabu " << tabu_set.size()
-                 << ", HistoryEntries " << history_count.size()
-                 << "\n";
+            total.tried += r.moves[nb].tried;
+            total.feasible += r.moves[nb].feasible;
+            total.accepted += r.moves[nb].accepted;
+            total.improved += r.moves[nb].improved;
+            weight += r.weights[nb] / results.size();
         }
-    } // main loop
+        cout << "[Phase3] Neighborhood " << kNeighborhoodNames[nb] << ": weight " << weight << ", " << total.tried
+             << " tried, " << total.feasible << " feasible, " << total.accepted << " accepted, " << total.improved
+             << " new best\n";
+    }
+
+    OptimalSolution out = to_optimal_solution(best, cp);
+    out.stop_reason = stop_reason_name(reason);
+    if (opts.verify)
+    {
+        out.verification = verify_schedule(best, start.objective_value, cp);
+        cout << "[Phase3] Verification: objective " << out.verification["objective"]["total"]
+             << (out.verification["matches_search"].get<bool>() ? " (matches search)" : " (DIFFERS from search)")
+             << ", " << out.verification["violations"].size() << " constraint violations\n";
+    }
+    out.iterations = iterations;
+    return out;
+}
 
-    cout << "[Phase3] Finished. Best objective: " << best.objective_value
-         << ", Total assignments: " << best.assignments.size() << "\n";
-    return best;
+Phase3Options phase3_options_from_json(const json &j)
+{
+    if (!j.is_object())
+        throw invalid_argument("options.phase3 must be an object");
+    Phase3Options opts;
+    try
+    {
+        opts.threads = j.value("threads", opts.threads);
+        opts.exchange_interval = j.value("exchange_interval", opts.exchange_interval);
+        opts.max_iterations = j.value("max_iterations", opts.max_iterations);
+        opts.time_limit_seconds = j.value("time_limit_seconds", opts.time_limit_seconds);
+        opts.stall_iterations = j.value("stall_iterations", opts.stall_iterations);
+        opts.progress_interval_seconds = j.value("progress_interval_seconds", opts.progress_interval_seconds);
+        opts.cooling = j.value("cooling", opts.cooling);
+        opts.verify = j.value("verify", opts.verify);
+        if (j.contains("seed") && !j["seed"].is_null())
+        {
+            opts.has_seed = true;
+            opts.seed = j["seed"].get<uint64_t>();
+        }
+    }
+    catch (const json::exception &ex) // a key of the wrong type
+    {
+        throw invalid_argument(string("options.phase3: ") + ex.what());
+    }
+    make_cooling(opts.cooling); // reject unknown names as a bad request, before solving
+    return opts;
 }
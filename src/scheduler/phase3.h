@@ -1,6 +1,7 @@
 #pragma once
 #include "phase1.h"
 #include "phase2.h"
+#include "solve_control.h"
 #include <vector>
 #include <string>
 using namespace std;
@@ -17,6 +18,10 @@ struct OptimalSolution {
 
     vector<Assignment> assignments;
     int objective_value = 0;
+    string stop_reason; // which Phase 3 stop criterion fired: iterations, time_limit, stalled or cancelled;
+                        // "repair" for a schedule from repair_schedule
+    int iterations = 0; // iterations run by the longest search
+    json verification;  // set by Phase3Options::verify: objective and constraints recomputed from scratch
     OptimalSolution() = default;
     OptimalSolution(const InitialSolution &init) {
         assignments.clear();
@@ -26,5 +31,25 @@ struct OptimalSolution {
     }
 };
 
+// Tham số cho phase 3
+struct Phase3Options {
+    int threads = 1;                // independent searches run in parallel, 0 = one per hardware thread
+    int exchange_interval = 100;    // iterations between best-solution exchanges
+    bool has_seed = false;          // seed the searches deterministically (search k uses seed and k)
+    uint64_t seed = 0;
+    int max_iterations = 1200;      // iteration budget per search
+    double time_limit_seconds = 0;  // wall-clock budget for the whole phase, 0 = none
+    int stall_iterations = 0;       // stop once best has not improved for this many iterations, 0 = never
+    double progress_interval_seconds = 0.5; // minimum gap between incumbent reports to SolveControl
+    string cooling = "geometric";   // SA cooling schedule: "geometric" or "lundy_mees"
+    bool verify = false;            // recompute the Phase 2 objective and constraints for the result
+};
+
+// Read Phase3Options from the "phase3" object of a request, missing keys keep their defaults.
+// Throws invalid_argument when j is not an object, a key has the wrong type or cooling is unknown.
+Phase3Options phase3_options_from_json(const json &j);
+
 // Hàm tìm phương án tối ưu sử dụng Simulated Annealing + Neighborhood Improvement
-OptimalSolution find_optimal_solution(const ProblemData& data, const InitialSolution& init_sol);
+OptimalSolution find_optimal_solution(const ProblemData& data, const InitialSolution& init_sol,
+                                      const Phase3Options &opts = Phase3Options(),
+                                      const SolveControl &ctl = SolveControl());
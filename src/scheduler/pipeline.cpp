@@ -0,0 +1,96 @@
+#include "pipeline.h"
+#include "lns.h"
+#include <iostream>
+#include <stdexcept>
+
+using namespace std;
+
+namespace
+{
+    json default_options = json::object();
+}
+
+void set_default_options(const json &options)
+{
+    default_options = options.is_object() ? options : json::object();
+}
+
+json solution_to_json(const OptimalSolution &opt)
+{
+    json js = json::object();
+    js["objective_value"] = opt.objective_value;
+    js["stop_reason"] = opt.stop_reason;
+    js["iterations"] = opt.iterations;
+    js["assignments"] = assignments_to_json(opt.assignments);
+    if (!opt.verification.is_null())
+        js["verification"] = opt.verification;
+    return js;
+}
+
+ScheduleRequest parse_schedule_request(const json &jin)
+{
+    ScheduleRequest req = make_schedule_request(initialize_problem_from_json(jin),
+                                                jin.contains("options") ? jin["options"] : json::object());
+
+    // warm start from the schedule a previous /schedule call returned
+    if (jin.contains("previous_solution") && jin["previous_solution"].contains("assignments"))
+        req.previous_assignments = assignments_from_json(jin["previous_solution"]["assignments"]);
+    return req;
+}
+
+ScheduleRequest make_schedule_request(ProblemData data, const json &options)
+{
+    if (!options.is_null() && !options.is_object())
+        throw invalid_argument("options must be an object");
+    ScheduleRequest req;
+    req.data = std::move(data);
+    req.options = default_options;
+    if (options.is_object())
+        req.options.merge_patch(options);
+    return req;
+}
+
+string request_hash(const ScheduleRequest &req)
+{
+    json extra = {{"options", req.options}, {"previous", assignments_to_json(req.previous_assignments)}};
+    if (extra["options"].is_object())
+        extra["options"].erase("cache"); // caching itself does not change the result
+    return problem_hash(req.data, extra);
+}
+
+OptimalSolution solve_schedule(const ScheduleRequest &req, const SolveControl &ctl)
+{
+    const json &options = req.options;
+
+    Phase2Options p2opts;
+    if (options.contains("phase2"))
+        p2opts = phase2_options_from_json(options["phase2"]);
+    p2opts.warm_start = req.previous_assignments;
+
+    LnsOptions lnsopts;
+    if (options.contains("lns"))
+        lnsopts = lns_options_from_json(options["lns"]);
+
+    Phase3Options p3opts;
+    if (options.contains("phase3"))
+        p3opts = phase3_options_from_json(options["phase3"]);
+
+    InitialSolution init = construct_initial_solution(req.data, p2opts, ctl);
+    cout << "[Pipeline] Initial solution constructed: " << init.assignments.size() << " assignments\n";
+
+    if (lnsopts.enabled && !ctl.cancelled())
+        init = improve_with_lns(req.data, init, lnsopts, ctl);
+
+    // Phase 3 returns the initial schedule right away when ctl is already cancelled
+    return find_optimal_solution(req.data, init, p3opts, ctl);
+}
+
+json solve_schedule_request(const json &jin, const SolveControl &ctl)
+{
+    OptimalSolution opt = solve_schedule(parse_schedule_request(jin), ctl);
+
+    json jout;
+    jout["status"] = "success";
+    jout["solution"] = solution_to_json(opt);
+    return jout;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include "phase1.h"
+#include "phase2.h"
+#include "phase3.h"
+#include "solve_control.h"
+
+// A parsed /schedule request body
+struct ScheduleRequest {
+    ProblemData data;
+    json options; // request "options" merged over the server defaults
+    vector<InitialSolution::Assignment> previous_assignments; // warm start, from "previous_solution"
+};
+
+// JSON form of a Phase 3 result, as returned under "solution"
+json solution_to_json(const OptimalSolution &opt);
+
+// Server-wide defaults for the "options" object of a request, e.g.
+// {"phase2": {"profile": "fast_feasible"}}. Options sent with a request are
+// merged over them key by key. Call once at startup, before any solve.
+void set_default_options(const json &options);
+
+ScheduleRequest parse_schedule_request(const json &jin);
+
+// Request for an already loaded problem (e.g. from a snapshot), options merged over the server defaults.
+// Throws invalid_argument when options is neither an object nor null.
+ScheduleRequest make_schedule_request(ProblemData data, const json &options = json::object());
+
+// Canonical hash of everything that determines the result of req (see problem_hash)
+string request_hash(const ScheduleRequest &req);
+
+// Run Phase 2 -> LNS (optional) -> Phase 3 on a parsed request
+OptimalSolution solve_schedule(const ScheduleRequest &req, const SolveControl &ctl = SolveControl());
+
+// Run Phase 1 -> Phase 2 -> Phase 3 on a /schedule request body and build the response
+json solve_schedule_request(const json &jin, const SolveControl &ctl = SolveControl());
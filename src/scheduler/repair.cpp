@@ -0,0 +1,422 @@
+#include "repair.h"
+#include "objective.h"
+#include "phase2_model.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+
+using namespace operations_research::sat;
+using namespace std;
+
+namespace
+{
+    int find_index(const unordered_map<string, int> &index, const string &id)
+    {
+        auto it = index.find(id);
+        return it == index.end() ? -1 : it->second;
+    }
+
+    json &find_course(json &problem, const string &course_id)
+    {
+        for (auto &jc : problem["courses"])
+            if (jc.value("id", string()) == course_id)
+                return jc;
+        throw invalid_argument("unknown course '" + course_id + "'");
+    }
+
+    // Apply one entry of "changes" to the request body; leaves are collected
+    // since the problem schema has no availability to write them into
+    void apply_change(json &problem, const json &change, vector<TeacherLeave> &leaves)
+    {
+        string type = change.at("type").get<string>();
+        if (type == "teacher_leave")
+        {
+            TeacherLeave leave;
+            leave.teacher_id = change.at("teacher_id").get<string>();
+            leave.days = change.value("days", vector<string>{});
+            leave.periods = change.value("periods", vector<string>{});
+            leaves.push_back(std::move(leave));
+        }
+        else if (type == "add_section")
+        {
+            json &course = find_course(problem, change.at("course_id").get<string>());
+            string section_id = change.at("section_id").get<string>();
+            json &sections = course["sections"];
+            if (sections.is_null())
+                sections = json::array();
+            for (const auto &s : sections)
+                if (s.value("id", string()) == section_id)
+                    throw invalid_argument("section '" + section_id + "' already exists");
+            sections.push_back({{"id", section_id}, {"required_periods", change.value("required_periods", 1)}});
+        }
+        else if (type == "remove_section")
+        {
+            json &course = find_course(problem, change.at("course_id").get<string>());
+            string section_id = change.at("section_id").get<string>();
+            json &sections = course["sections"];
+            auto it = sections.is_array() ? find_if(sections.begin(), sections.end(), [&](const json &s)
+                                                    { return s.value("id", string()) == section_id; })
+                                          : sections.end();
+            if (it == sections.end())
+                throw invalid_argument("unknown section '" + section_id + "'");
+            sections.erase(it);
+        }
+        else if (type == "room_closure")
+        {
+            json &classrooms = problem.at("classrooms");
+            vector<string> days = classrooms.value("days", vector<string>{});
+            vector<string> all_periods = classrooms.value("periods", vector<string>{});
+            string day = change.at("day").get<string>();
+            if (find(days.begin(), days.end(), day) == days.end())
+                throw invalid_argument("unknown day '" + day + "'");
+            vector<string> periods = change.value("periods", all_periods);
+            for (const auto &period : periods)
+                if (find(all_periods.begin(), all_periods.end(), period) == all_periods.end())
+                    throw invalid_argument("unknown period '" + period + "'");
+            int closed = change.contains("rooms") ? change["rooms"].get<int>() : -1;
+            if (change.contains("rooms") && closed < 0)
+                throw invalid_argument("rooms must not be negative");
+            // a day without classrooms_per_slot has no rooms to close
+            if (!classrooms.contains("classrooms_per_slot") || !classrooms["classrooms_per_slot"].contains(day))
+                return;
+            json &per_slot = classrooms["classrooms_per_slot"][day];
+            for (const auto &period : periods)
+            {
+                int rooms = per_slot.value(period, 0);
+                per_slot[period] = closed >= 0 ? max(0, rooms - closed) : 0;
+            }
+        }
+        else
+            throw invalid_argument("unknown change type: " + type);
+    }
+
+    // Slots each teacher is on leave, (i * L + l) * M + m
+    vector<char> leave_slots(const CompiledProblem &cp, const vector<TeacherLeave> &leaves)
+    {
+        const int L = cp.num_days;
+        const int M = cp.num_periods;
+        vector<char> unavailable((size_t)cp.num_teachers * L * M, 0);
+        auto indices = [&](const vector<string> &ids, const unordered_map<string, int> &index, int n, const char *what)
+        {
+            vector<int> out;
+            for (const auto &id : ids)
+            {
+                int k = find_index(index, id);
+                if (k < 0)
+                    throw invalid_argument(string("unknown ") + what + " '" + id + "'");
+                out.push_back(k);
+            }
+            if (ids.empty())
+                for (int k = 0; k < n; ++k)
+                    out.push_back(k);
+            return out;
+        };
+        for (const auto &leave : leaves)
+        {
+            int i = find_index(cp.teacher_index, leave.teacher_id);
+            if (i < 0)
+                throw invalid_argument("unknown teacher '" + leave.teacher_id + "'");
+            for (int l : indices(leave.days, cp.day_index, L, "day"))
+                for (int m : indices(leave.periods, cp.period_index, M, "period"))
+                    unavailable[((size_t)i * L + l) * M + m] = 1;
+        }
+        return unavailable;
+    }
+
+    // Sections whose previous assignment is missing, no longer allowed, or
+    // overlaps another one after the edits (every section of an overfull slot)
+    vector<char> find_conflicts(const CompiledProblem &cp, const vector<PinnedStart> &previous,
+                                const vector<char> &unavailable)
+    {
+        const int L = cp.num_days;
+        const int M = cp.num_periods;
+        const int S = cp.num_slots();
+        vector<char> conflict(cp.num_sections, 0);
+        for (int s = 0; s < cp.num_sections; ++s)
+        {
+            const PinnedStart &p = previous[s];
+            int r = cp.section_required_periods[s];
+            if (p.teacher < 0 || !cp.eligible(p.teacher, cp.section_course[s]) || p.start + r > M)
+            {
+                conflict[s] = 1;
+                continue;
+            }
+            for (int m = p.start; m < p.start + r; ++m)
+                if (unavailable[((size_t)p.teacher * L + p.day) * M + m])
+                    conflict[s] = 1;
+        }
+
+        vector<int> slot_used(S, 0), teacher_slot((size_t)cp.num_teachers * S, 0), course_slot((size_t)cp.num_courses * S, 0);
+        auto for_each_slot = [&](int s, auto f)
+        {
+            for (int m = previous[s].start; m < previous[s].start + cp.section_required_periods[s]; ++m)
+                f(cp.slot(previous[s].day, m));
+        };
+        for (int s = 0; s < cp.num_sections; ++s)
+            if (!conflict[s])
+                for_each_slot(s, [&](int sk)
+                              {
+                                  ++slot_used[sk];
+                                  ++teacher_slot[(size_t)previous[s].teacher * S + sk];
+                                  ++course_slot[(size_t)cp.section_course[s] * S + sk]; });
+        for (int s = 0; s < cp.num_sections; ++s)
+            if (!conflict[s])
+                for_each_slot(s, [&](int sk)
+                              {
+                                  if (slot_used[sk] > cp.capacity[sk] ||
+                                      teacher_slot[(size_t)previous[s].teacher * S + sk] > 1 ||
+                                      course_slot[(size_t)cp.section_course[s] * S + sk] > 1)
+                                      conflict[s] = 1; });
+        return conflict;
+    }
+
+    // Sections free to move at the given radius (see repair_schedule)
+    vector<char> neighborhood(const CompiledProblem &cp, const vector<PinnedStart> &previous,
+                              const vector<char> &conflict, int radius)
+    {
+        if (radius >= 3)
+            return vector<char>(cp.num_sections, 1);
+        vector<char> freed = conflict;
+        if (radius == 0)
+            return freed;
+        vector<char> course_in(cp.num_courses, 0), teacher_in(cp.num_teachers, 0);
+        for (int s = 0; s < cp.num_sections; ++s)
+        {
+            if (!conflict[s])
+                continue;
+            int j = cp.section_course[s];
+            course_in[j] = 1;
+            if (previous[s].teacher >= 0)
+                teacher_in[previous[s].teacher] = 1;
+            if (radius >= 2)
+                for (int i : cp.course_eligible_teachers[j])
+                    teacher_in[i] = 1;
+        }
+        // teachers of the affected courses, who may have to take over a section
+        for (int s = 0; s < cp.num_sections; ++s)
+            if (course_in[cp.section_course[s]] && previous[s].teacher >= 0)
+                teacher_in[previous[s].teacher] = 1;
+        for (int s = 0; s < cp.num_sections; ++s)
+            if (course_in[cp.section_course[s]] || (previous[s].teacher >= 0 && teacher_in[previous[s].teacher]))
+                freed[s] = 1;
+        return freed;
+    }
+
+    json placement_json(const CompiledProblem &cp, const PinnedStart &p)
+    {
+        if (p.teacher < 0)
+            return nullptr;
+        return {{"teacher_id", cp.teacher_ids[p.teacher]}, {"day", cp.days[p.day]}, {"period", cp.periods[p.start]}};
+    }
+} // anonymous namespace
+
+RepairOptions repair_options_from_json(const json &j)
+{
+    RepairOptions opts;
+    opts.time_limit_seconds = j.value("time_limit_seconds", opts.time_limit_seconds);
+    opts.workers = j.value("workers", opts.workers);
+    opts.max_radius = j.value("max_radius", opts.max_radius);
+    opts.disruption_weight = j.value("disruption_weight", opts.disruption_weight);
+    if (j.contains("seed") && !j["seed"].is_null())
+    {
+        opts.has_seed = true;
+        opts.seed = j["seed"].get<int>();
+    }
+    return opts;
+}
+
+RepairRequest parse_repair_request(const json &jin)
+{
+    if (!jin.contains("previous_solution") || !jin["previous_solution"].contains("assignments"))
+        throw invalid_argument("repair needs previous_solution.assignments");
+
+    // everything that fails from here on is a problem with the body (missing
+    // keys, wrong types, unknown ids), reported as such to the caller
+    try
+    {
+        json problem = jin;
+        vector<TeacherLeave> leaves;
+        if (jin.contains("changes"))
+        {
+            if (!jin["changes"].is_array())
+                throw invalid_argument("changes must be an array");
+            for (const auto &change : jin["changes"])
+                apply_change(problem, change, leaves);
+        }
+
+        RepairRequest req;
+        req.schedule = parse_schedule_request(problem);
+        req.leaves = std::move(leaves);
+        leave_slots(req.schedule.data.compiled, req.leaves); // unknown teachers, days or periods
+        return req;
+    }
+    catch (const json::exception &ex)
+    {
+        throw invalid_argument(ex.what());
+    }
+    catch (const runtime_error &ex)
+    {
+        throw invalid_argument(ex.what());
+    }
+}
+
+RepairResult repair_schedule(const RepairRequest &req, const SolveControl &ctl)
+{
+    const CompiledProblem &cp = req.schedule.data.compiled;
+    RepairOptions opts;
+    if (req.schedule.options.contains("repair"))
+        opts = repair_options_from_json(req.schedule.options["repair"]);
+    auto start = chrono::steady_clock::now();
+    auto elapsed = [&]
+    { return chrono::duration<double>(chrono::steady_clock::now() - start).count(); };
+
+    RepairResult result;
+
+    // previous assignment of every section, teacher < 0 when it had none
+    vector<PinnedStart> previous(cp.num_sections);
+    for (const auto &a : req.schedule.previous_assignments)
+    {
+        int i = find_index(cp.teacher_index, a.teacher_id);
+        int j = find_index(cp.course_index, a.course_id);
+        int l = find_index(cp.day_index, a.day);
+        int m = find_index(cp.period_index, a.period);
+        int s = j < 0 ? -1 : cp.section_index(j, a.section_id);
+        if (i < 0 || s < 0 || l < 0 || m < 0 || previous[s].teacher >= 0)
+        {
+            ++result.dropped;
+            continue;
+        }
+        previous[s] = {i, l, m};
+    }
+
+    ModelScope scope;
+    scope.unavailable = leave_slots(cp, req.leaves);
+    // a teacher on leave for the whole timetable drops out, "teaches at least one course" included
+    const size_t LM = (size_t)cp.num_days * cp.num_periods;
+    for (int i = 0; i < cp.num_teachers; ++i)
+        if (!all_of(scope.unavailable.begin() + i * LM, scope.unavailable.begin() + (i + 1) * LM, [](char c)
+                    { return c != 0; }))
+            scope.teachers.push_back(i);
+
+    vector<char> conflict = find_conflicts(cp, previous, scope.unavailable);
+    result.conflicts = (int)count(conflict.begin(), conflict.end(), 1);
+    cout << "[Repair] " << result.conflicts << " conflicting sections, " << result.dropped
+         << " previous assignments dropped\n";
+
+    vector<char> last_freed;
+    for (int radius = 0; radius <= max(0, opts.max_radius) && !ctl.cancelled(); ++radius)
+    {
+        vector<char> freed = neighborhood(cp, previous, conflict, radius);
+        if (freed == last_freed)
+            continue;
+        last_freed = freed;
+
+        scope.pinned = previous;
+        for (int s = 0; s < cp.num_sections; ++s)
+            if (freed[s])
+                scope.pinned[s].teacher = -1;
+
+        // the order of interchangeable sections is fixed by the previous schedule, so no symmetry breaking
+        auto build_start = chrono::steady_clock::now();
+        Phase2Model pm;
+        build_phase2_model(cp, pm, false, scope);
+
+        // changed assignments among the freed sections that had one; hint the previous starts
+        LinearExpr changed;
+        int64_t movable = 0;
+        for (int s = 0; s < cp.num_sections; ++s)
+        {
+            if (!freed[s] || previous[s].teacher < 0)
+                continue;
+            ++movable;
+            changed += 1;
+            int v = pm.find_start(previous[s].teacher, s, previous[s].day, previous[s].start);
+            if (v >= 0)
+                changed -= pm.y[v].var;
+            for (int w : pm.by_section[s])
+                pm.builder.AddHint(pm.y[w].var, w == v);
+        }
+        if (opts.disruption_weight > 0)
+            pm.builder.Maximize(pm.objective - changed * opts.disruption_weight);
+        else
+            pm.builder.Maximize(pm.objective * (movable + 1) - changed); // lexicographic: objective, then changes
+        double build_seconds = chrono::duration<double>(chrono::steady_clock::now() - build_start).count();
+
+        int attempts_left = max(0, opts.max_radius) - radius + 1;
+        SatParameters params;
+        params.set_max_time_in_seconds(max(0.01, (opts.time_limit_seconds - elapsed()) / attempts_left));
+        params.set_num_search_workers(max(1, opts.workers));
+        params.set_log_search_progress(false);
+        params.set_repair_hint(true);
+        if (opts.has_seed)
+            params.set_random_seed(opts.seed);
+
+        auto solve_start = chrono::steady_clock::now();
+        CpSolverResponse response = solve_phase2_model(pm, params, ctl);
+        double solve_seconds = chrono::duration<double>(chrono::steady_clock::now() - solve_start).count();
+        if (ctl.stats)
+        {
+            ctl.stats->add_duration("phase2_build", build_seconds);
+            ctl.stats->add_duration("repair_solve", solve_seconds);
+            ctl.stats->add_cpsat_status("repair", CpSolverStatus_Name(response.status()));
+        }
+        int freed_count = (int)count(freed.begin(), freed.end(), 1);
+        cout << "[Repair] radius " << radius << ": " << freed_count << " sections freed, "
+             << CpSolverStatus_Name(response.status()) << " in " << solve_seconds << "s\n";
+        if (!has_solution(response))
+            continue;
+
+        vector<PinnedStart> repaired = previous;
+        for (const auto &sv : pm.y)
+            if (SolutionBooleanValue(response, sv.var))
+                repaired[sv.section] = {sv.teacher, sv.day, sv.start};
+
+        InitialSolution sol;
+        vector<Placement> placements;
+        for (int s = 0; s < cp.num_sections; ++s)
+        {
+            const PinnedStart &p = repaired[s];
+            int j = cp.section_course[s];
+            sol.assignments.push_back({cp.teacher_ids[p.teacher], cp.course_ids[j], cp.section_ids[s],
+                                       cp.days[p.day], cp.periods[p.start]});
+            placements.push_back({p.teacher, j, s, p.day, p.start});
+            const PinnedStart &before = previous[s];
+            if (before.teacher != p.teacher || before.day != p.day || before.start != p.start)
+                result.changes.push_back({{"course_id", cp.course_ids[j]},
+                                          {"section_id", cp.section_ids[s]},
+                                          {"before", placement_json(cp, before)},
+                                          {"after", placement_json(cp, p)}});
+        }
+        result.solution = OptimalSolution(sol);
+        result.solution.objective_value = (int)evaluate_objective(cp, placements).total();
+        result.solution.stop_reason = "repair";
+        result.cpsat_status = CpSolverStatus_Name(response.status());
+        result.freed = freed_count;
+        result.radius = radius;
+        cout << "[Repair] " << result.changes.size() << " assignments changed, objective "
+             << result.solution.objective_value << ", " << elapsed() << "s\n";
+        return result;
+    }
+    throw runtime_error(ctl.cancelled() ? "repair cancelled" : "no feasible repair found");
+}
+
+json repair_to_json(const RepairResult &r)
+{
+    json jout;
+    jout["status"] = "success";
+    jout["solution"] = solution_to_json(r.solution);
+    jout["repair"] = {{"cpsat_status", r.cpsat_status},
+                      {"conflicts", r.conflicts},
+                      {"freed", r.freed},
+                      {"radius", r.radius},
+                      {"dropped", r.dropped},
+                      {"changed", r.changes.size()},
+                      {"changes", r.changes}};
+    return jout;
+}
+
+json repair_schedule_request(const json &jin, const SolveControl &ctl)
+{
+    return repair_to_json(repair_schedule(parse_repair_request(jin), ctl));
+}
@@ -0,0 +1,69 @@
+#pragma once
+// Incremental re-scheduling (POST /schedule/repair): apply a few edits to a
+// solved problem, keep every assignment the edits do not touch, and re-solve
+// only the conflicting sections with the Phase 2 model.
+#include "pipeline.h"
+#include "solve_control.h"
+using namespace std;
+
+// Tham số cho sửa lịch ("repair" object of the request options)
+struct RepairOptions {
+    double time_limit_seconds = 5; // CP-SAT budget for all attempts together
+    int workers = 8;               // CP-SAT workers
+    int max_radius = 3;            // widest neighborhood tried, see repair_schedule
+    int disruption_weight = 0;     // 0 = changed assignments only break ties of the objective,
+                                   // w > 0 = maximize objective - w * changed assignments
+    bool has_seed = false;
+    int seed = 0;
+};
+
+// Read RepairOptions from the "repair" object of a request, missing keys keep their defaults
+RepairOptions repair_options_from_json(const json &j);
+
+// A teacher who cannot teach on some days and periods; empty lists mean all of them
+struct TeacherLeave {
+    string teacher_id;
+    vector<string> days;
+    vector<string> periods;
+};
+
+struct RepairRequest {
+    ScheduleRequest schedule;   // problem with the edits applied, options, previous assignments
+    vector<TeacherLeave> leaves;
+};
+
+// Parse a /schedule/repair body: a /schedule request with "previous_solution"
+// (required) and "changes", an array of edits applied in order:
+//   {"type": "teacher_leave", "teacher_id": "T3", "days": ["Thu"], "periods": ["1", "2"]}
+//   {"type": "add_section", "course_id": "C1", "section_id": "S4", "required_periods": 2}
+//   {"type": "remove_section", "course_id": "C1", "section_id": "S2"}
+//   {"type": "room_closure", "day": "Thu", "periods": ["3"], "rooms": 1}
+// days, periods and rooms are optional and default to all of them.
+// Throws invalid_argument when the body is malformed or names an unknown
+// course, section, teacher, day or period.
+RepairRequest parse_repair_request(const json &jin);
+
+struct RepairResult {
+    OptimalSolution solution;
+    string cpsat_status;      // CP-SAT status of the accepted attempt (OPTIMAL or FEASIBLE)
+    int conflicts = 0;        // sections whose previous assignment no longer fits, or that are new
+    int freed = 0;            // sections the accepted attempt could move
+    int radius = 0;           // neighborhood of the accepted attempt
+    int dropped = 0;          // previous assignments of sections that no longer exist
+    json changes = json::array(); // per moved or new section: course_id, section_id, before, after
+};
+
+// Re-solve with every section outside the neighborhood pinned to its previous
+// assignment. The neighborhood grows until the model is feasible:
+//   radius 0: the conflicting sections
+//   radius 1: plus every section of their courses and of the teachers of those courses
+//   radius 2: plus every section of the teachers eligible for those courses
+//   radius 3: every section
+// Throws runtime_error when no attempt finds a schedule.
+RepairResult repair_schedule(const RepairRequest &req, const SolveControl &ctl = SolveControl());
+
+// The /schedule/repair response: status, solution (as in /schedule) and a "repair" report
+json repair_to_json(const RepairResult &r);
+
+// parse_repair_request + repair_schedule + repair_to_json
+json repair_schedule_request(const json &jin, const SolveControl &ctl = SolveControl());
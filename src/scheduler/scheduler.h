@@ -0,0 +1,20 @@
+#pragma once
+// Public API of the scheduler_core library.
+//
+//   ScheduleRequest req = parse_schedule_request(body);   // Phase 1 + options
+//   OptimalSolution sol = solve_schedule(req);             // Phase 2 -> LNS -> Phase 3
+//   json out = solution_to_json(sol);
+//
+// or solve_schedule_request(body) for the full /schedule response. The
+// phases can also be called one by one (construct_initial_solution,
+// improve_with_lns, find_optimal_solution); SolveControl adds cancellation
+// and incumbent callbacks to all of them. repair_schedule_request(body)
+// re-solves a few edits of a previous schedule (/schedule/repair).
+#include "phase1.h"
+#include "phase2.h"
+#include "lns.h"
+#include "objective.h"
+#include "phase3.h"
+#include "pipeline.h"
+#include "repair.h"
+#include "solve_control.h"
@@ -0,0 +1,340 @@
+#include "snapshot.h"
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <type_traits>
+#include <unistd.h>
+
+using namespace std;
+
+namespace
+{
+    const char kMagic[8] = {'T', 'S', 'C', 'H', 'S', 'N', 'A', 'P'};
+    const uint32_t kByteOrder = 0x01020304;
+
+    // arrays of the snapshot, in file order
+    enum class Array
+    {
+        CourseSectionBegin, // int32 [J + 1]
+        SectionCourse,      // int32 [S]
+        SectionRequiredPeriods,
+        TeacherMaxCourses,  // int32 [I]
+        CourseMinTeachers,  // int32 [J]
+        CourseMaxTeachers,
+        EligibleBegin,      // int32 [J + 1], CSR of course_eligible_teachers
+        EligibleTeachers,   // int32
+        TimePref,           // int32 [I * L * M]
+        CoursePref,         // int32 [I * J]
+        Capacity,           // int32 [L * M]
+        EligibleBits,       // uint64 [I * eligible_words]
+        StringBegin,        // uint32 [I + J + S + L + M + 1], offsets into StringChars
+        StringChars,        // teacher, course, section, day and period ids back to back
+    };
+    const int kArrays = (int)Array::StringChars + 1;
+
+    struct SnapshotHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order;
+        uint64_t file_size;
+        int32_t num_teachers;
+        int32_t num_courses;
+        int32_t num_sections;
+        int32_t num_days;
+        int32_t num_periods;
+        int32_t eligible_words;
+        struct
+        {
+            uint64_t offset; // bytes from the start of the file
+            uint64_t size;   // bytes
+        } arrays[kArrays];
+    };
+
+    uint64_t align8(uint64_t n) { return (n + 7) & ~uint64_t(7); }
+
+    // Read-only mapping of a whole file, unmapped on destruction
+    class MappedFile
+    {
+    public:
+        explicit MappedFile(const string &path)
+        {
+            int fd = open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+                throw runtime_error("cannot open " + path);
+            struct stat st;
+            if (fstat(fd, &st) != 0)
+            {
+                close(fd);
+                throw runtime_error("cannot stat " + path);
+            }
+            size_ = (size_t)st.st_size;
+            if (size_ > 0)
+                data_ = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd);
+            if (data_ == MAP_FAILED)
+                throw runtime_error("cannot map " + path);
+        }
+        ~MappedFile()
+        {
+            if (data_ && data_ != MAP_FAILED)
+                munmap(data_, size_);
+        }
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        const char *data() const { return (const char *)data_; }
+        size_t size() const { return size_; }
+
+    private:
+        void *data_ = nullptr;
+        size_t size_ = 0;
+    };
+} // anonymous namespace
+
+void write_snapshot(const CompiledProblem &cp, const string &path)
+{
+    vector<int32_t> eligible_begin{0}, eligible_teachers;
+    for (const auto &teachers : cp.course_eligible_teachers)
+    {
+        eligible_teachers.insert(eligible_teachers.end(), teachers.begin(), teachers.end());
+        eligible_begin.push_back((int32_t)eligible_teachers.size());
+    }
+    vector<uint32_t> string_begin{0};
+    string chars;
+    for (const auto *ids : {&cp.teacher_ids, &cp.course_ids, &cp.section_ids, &cp.days, &cp.periods})
+        for (const auto &id : *ids)
+        {
+            chars += id;
+            string_begin.push_back((uint32_t)chars.size());
+        }
+
+    const void *data[kArrays] = {
+        cp.course_section_begin.data(), cp.section_course.data(), cp.section_required_periods.data(),
+        cp.teacher_max_courses.data(), cp.course_min_teachers.data(), cp.course_max_teachers.data(),
+        eligible_begin.data(), eligible_teachers.data(), cp.time_pref.data(), cp.course_pref.data(),
+        cp.capacity.data(), cp.eligible_bits.data(), string_begin.data(), chars.data()};
+    const uint64_t sizes[kArrays] = {
+        cp.course_section_begin.size() * 4, cp.section_course.size() * 4, cp.section_required_periods.size() * 4,
+        cp.teacher_max_courses.size() * 4, cp.course_min_teachers.size() * 4, cp.course_max_teachers.size() * 4,
+        eligible_begin.size() * 4, eligible_teachers.size() * 4, cp.time_pref.size() * 4, cp.course_pref.size() * 4,
+        cp.capacity.size() * 4, cp.eligible_bits.size() * 8, string_begin.size() * 4, chars.size()};
+
+    SnapshotHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, kMagic, sizeof(kMagic));
+    h.version = kSnapshotVersion;
+    h.byte_order = kByteOrder;
+    h.num_teachers = cp.num_teachers;
+    h.num_courses = cp.num_courses;
+    h.num_sections = cp.num_sections;
+    h.num_days = cp.num_days;
+    h.num_periods = cp.num_periods;
+    h.eligible_words = cp.eligible_words;
+    uint64_t offset = align8(sizeof(h));
+    for (int a = 0; a < kArrays; ++a)
+    {
+        h.arrays[a].offset = offset;
+        h.arrays[a].size = sizes[a];
+        offset = align8(offset + sizes[a]);
+    }
+    h.file_size = offset;
+
+    ofstream out(path, ios::binary | ios::trunc);
+    if (!out)
+        throw runtime_error("cannot write " + path);
+    const char zeros[8] = {};
+    out.write((const char *)&h, sizeof(h));
+    out.write(zeros, align8(sizeof(h)) - sizeof(h));
+    for (int a = 0; a < kArrays; ++a)
+    {
+        out.write((const char *)data[a], sizes[a]);
+        out.write(zeros, align8(sizes[a]) - sizes[a]);
+    }
+    if (!out)
+        throw runtime_error("cannot write " + path);
+}
+
+CompiledProblem read_snapshot(const string &path)
+{
+    MappedFile file(path);
+    SnapshotHeader h;
+    if (file.size() < sizeof(h))
+        throw runtime_error(path + ": not a problem snapshot");
+    memcpy(&h, file.data(), sizeof(h));
+    if (memcmp(h.magic, kMagic, sizeof(kMagic)) != 0)
+        throw runtime_error(path + ": not a problem snapshot");
+    if (h.version != kSnapshotVersion)
+        throw runtime_error(path + ": snapshot version " + to_string(h.version) + ", expected " +
+                            to_string(kSnapshotVersion));
+    if (h.byte_order != kByteOrder)
+        throw runtime_error(path + ": snapshot written with another byte order");
+    if (h.file_size != file.size())
+        throw runtime_error(path + ": truncated snapshot");
+
+    auto corrupt = [&]
+    { return runtime_error(path + ": corrupt snapshot"); };
+    if (h.num_teachers < 0 || h.num_courses < 0 || h.num_sections < 0 || h.num_days < 0 || h.num_periods < 0 ||
+        h.eligible_words != (h.num_courses + 63) / 64)
+        throw corrupt();
+
+    CompiledProblem cp;
+    cp.num_teachers = h.num_teachers;
+    cp.num_courses = h.num_courses;
+    cp.num_sections = h.num_sections;
+    cp.num_days = h.num_days;
+    cp.num_periods = h.num_periods;
+    cp.eligible_words = h.eligible_words;
+    const size_t I = cp.num_teachers, J = cp.num_courses, S = cp.num_sections, L = cp.num_days, M = cp.num_periods;
+    const size_t num_ids = I + J + S + L + M;
+
+    // copy array a into out, which must hold exactly count elements
+    auto load = [&](Array a, auto &out, size_t count)
+    {
+        using T = typename decay_t<decltype(out)>::value_type;
+        const auto &e = h.arrays[(int)a];
+        if (e.offset > file.size() || e.size > file.size() - e.offset || e.size % sizeof(T) != 0 ||
+            (count != SIZE_MAX && e.size != count * sizeof(T)))
+            throw corrupt();
+        out.resize(e.size / sizeof(T));
+        if (e.size > 0)
+            memcpy(out.data(), file.data() + e.offset, e.size);
+    };
+    load(Array::CourseSectionBegin, cp.course_section_begin, J + 1);
+    load(Array::SectionCourse, cp.section_course, S);
+    load(Array::SectionRequiredPeriods, cp.section_required_periods, S);
+    load(Array::TeacherMaxCourses, cp.teacher_max_courses, I);
+    load(Array::CourseMinTeachers, cp.course_min_teachers, J);
+    load(Array::CourseMaxTeachers, cp.course_max_teachers, J);
+
+    // element counts of the matrices; a product past the file size cannot match its array
+    auto product = [&](size_t a, size_t b)
+    { return b != 0 && a > file.size() / b ? file.size() + 1 : a * b; };
+    load(Array::TimePref, cp.time_pref, product(product(I, L), M));
+    load(Array::CoursePref, cp.course_pref, product(I, J));
+    load(Array::Capacity, cp.capacity, product(L, M));
+    load(Array::EligibleBits, cp.eligible_bits, product(I, cp.eligible_words));
+
+    // every index the solver follows without a bounds check must be in range
+    if (cp.course_section_begin[0] != 0 || (size_t)cp.course_section_begin[J] != S)
+        throw corrupt();
+    for (size_t j = 0; j < J; ++j)
+        if (cp.course_section_begin[j] > cp.course_section_begin[j + 1])
+            throw corrupt();
+    for (size_t j = 0; j < J; ++j)
+    {
+        for (int k = cp.course_section_begin[j]; k < cp.course_section_begin[j + 1]; ++k)
+            if (cp.section_course[k] != (int)j)
+                throw corrupt();
+    }
+    for (size_t k = 0; k < S; ++k)
+        if (cp.section_required_periods[k] < 1)
+            throw corrupt();
+
+    vector<int32_t> eligible_begin, eligible_teachers;
+    load(Array::EligibleBegin, eligible_begin, J + 1);
+    load(Array::EligibleTeachers, eligible_teachers, SIZE_MAX);
+    for (int i : eligible_teachers)
+        if (i < 0 || (size_t)i >= I)
+            throw corrupt();
+    cp.course_eligible_teachers.resize(J);
+    for (size_t j = 0; j < J; ++j)
+    {
+        if (eligible_begin[j] < 0 || eligible_begin[j] > eligible_begin[j + 1] ||
+            (size_t)eligible_begin[j + 1] > eligible_teachers.size())
+            throw corrupt();
+        cp.course_eligible_teachers[j].assign(eligible_teachers.begin() + eligible_begin[j],
+                                              eligible_teachers.begin() + eligible_begin[j + 1]);
+    }
+
+    vector<uint32_t> string_begin;
+    vector<char> chars;
+    load(Array::StringBegin, string_begin, num_ids + 1);
+    load(Array::StringChars, chars, SIZE_MAX);
+    size_t next = 0;
+    auto ids = [&](vector<string> &out, unordered_map<string, int> *index, size_t count)
+    {
+        out.reserve(count);
+        for (size_t k = 0; k < count; ++k, ++next)
+        {
+            if (string_begin[next] > string_begin[next + 1] || string_begin[next + 1] > chars.size())
+                throw corrupt();
+            out.emplace_back(chars.data() + string_begin[next], string_begin[next + 1] - string_begin[next]);
+            if (index)
+                (*index)[out.back()] = (int)k;
+        }
+    };
+    ids(cp.teacher_ids, &cp.teacher_index, I);
+    ids(cp.course_ids, &cp.course_index, J);
+    ids(cp.section_ids, nullptr, S);
+    ids(cp.days, &cp.day_index, L);
+    ids(cp.periods, &cp.period_index, M);
+    return cp;
+}
+
+ProblemData problem_from_snapshot(const string &path)
+{
+    ProblemData data;
+    data.compiled = read_snapshot(path);
+    return data;
+}
+
+bool is_snapshot(const string &path)
+{
+    ifstream in(path, ios::binary);
+    char magic[sizeof(kMagic)];
+    return in.read(magic, sizeof(magic)) && memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+}
+
+json problem_to_json(const CompiledProblem &cp)
+{
+    const int J = cp.num_courses, L = cp.num_days, M = cp.num_periods;
+    json out;
+
+    // eligible_courses in the order of the eligibility bitset; Course::Ij is
+    // rebuilt from the preferences on load
+    out["teachers"] = json::array();
+    for (int i = 0; i < cp.num_teachers; ++i)
+    {
+        json t = {{"id", cp.teacher_ids[i]}, {"max_courses", cp.teacher_max_courses[i]}};
+        t["eligible_courses"] = json::array();
+        t["course_preferences"] = json::object();
+        for (int j = 0; j < J; ++j)
+        {
+            if (cp.eligible(i, j))
+                t["eligible_courses"].push_back(cp.course_ids[j]);
+            if (cp.pc(i, j) != 0)
+                t["course_preferences"][cp.course_ids[j]] = cp.pc(i, j);
+        }
+        json prefs = json::object();
+        for (int l = 0; l < L; ++l)
+            for (int m = 0; m < M; ++m)
+                if (cp.pt(i, l, m) != 0)
+                    prefs[cp.days[l]][cp.periods[m]] = cp.pt(i, l, m);
+        t["day_time_preferences"] = prefs;
+        out["teachers"].push_back(std::move(t));
+    }
+
+    out["courses"] = json::array();
+    for (int j = 0; j < J; ++j)
+    {
+        json c = {{"id", cp.course_ids[j]},
+                  {"min_teachers", cp.course_min_teachers[j]},
+                  {"max_teachers", cp.course_max_teachers[j]}};
+        c["sections"] = json::array();
+        for (int s = cp.course_section_begin[j]; s < cp.course_section_begin[j + 1]; ++s)
+            c["sections"].push_back({{"id", cp.section_ids[s]}, {"required_periods", cp.section_required_periods[s]}});
+        out["courses"].push_back(std::move(c));
+    }
+
+    json per_slot = json::object();
+    for (int l = 0; l < L; ++l)
+        for (int m = 0; m < M; ++m)
+            per_slot[cp.days[l]][cp.periods[m]] = cp.cap(l, m);
+    out["classrooms"] = {{"days", cp.days}, {"periods", cp.periods}, {"classrooms_per_slot", per_slot}};
+    return out;
+}
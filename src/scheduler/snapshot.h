@@ -0,0 +1,33 @@
+#pragma once
+// Binary snapshot of a CompiledProblem: the flat arrays written back to back
+// after a fixed header, so loading is an mmap plus one copy per array instead
+// of a JSON parse. Used by scheduler_cli for .snap inputs.
+//
+// Layout (host byte order, checked on load):
+//   SnapshotHeader | array 0 | array 1 | ...   every array 8-byte aligned
+// A change of the layout must bump kSnapshotVersion; older files are rejected.
+#include "phase1.h"
+#include <cstdint>
+#include <string>
+using namespace std;
+
+const uint32_t kSnapshotVersion = 1;
+
+// Write cp to path; throws runtime_error when the file cannot be written
+void write_snapshot(const CompiledProblem &cp, const string &path);
+
+// Map path and copy it into a CompiledProblem; throws runtime_error on a
+// truncated file, another version or byte order, inconsistent sizes, or
+// indices (sections, courses, eligible teachers) out of range
+CompiledProblem read_snapshot(const string &path);
+
+// ProblemData ready for construct_initial_solution / solve_schedule. Only
+// compiled is filled: the string-based fields (and so problem_hash) stay empty.
+ProblemData problem_from_snapshot(const string &path);
+
+// True when path starts with the snapshot magic
+bool is_snapshot(const string &path);
+
+// Input JSON layout (teachers, courses, classrooms) of cp. Names are not
+// part of the compiled form and come back empty; zero preferences are left out.
+json problem_to_json(const CompiledProblem &cp);
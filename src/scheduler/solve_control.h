@@ -0,0 +1,109 @@
+#pragma once
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+using json = nlohmann::json;
+using namespace std;
+
+// Most threads one phase may start for a request (phase2.decompose_threads,
+// lns.threads, phase3.threads), 0 = one per hardware thread. Set once at
+// startup from custom_config.max_solver_threads.
+inline atomic<int> max_solver_threads{0};
+
+// Threads to start for a requested count: 0 asks for one per hardware thread,
+// and the result never exceeds the hardware or the server limit
+inline int solver_threads(int requested)
+{
+    int hardware = max(1, (int)thread::hardware_concurrency());
+    int limit = max_solver_threads.load() > 0 ? min(max_solver_threads.load(), hardware) : hardware;
+    return max(1, min(requested > 0 ? requested : hardware, limit));
+}
+
+// An improved schedule found while solving
+struct IncumbentUpdate {
+    string phase;           // "phase2", "lns" or "phase3"
+    long long objective_value = 0;
+    double elapsed_seconds = 0; // since the phase started
+    json assignments;       // same layout as solution.assignments in the /schedule response
+};
+
+// JSON array of assignments (any type with teacher_id, course_id, section_id, day, period)
+template <class Assignments>
+json assignments_to_json(const Assignments &list)
+{
+    json arr = json::array();
+    for (const auto &a : list)
+        arr.push_back({{"teacher_id", a.teacher_id},
+                       {"course_id", a.course_id},
+                       {"section_id", a.section_id},
+                       {"day", a.day},
+                       {"period", a.period}});
+    return arr;
+}
+
+// Timings and counters of one solve, filled in when SolveControl::stats is set.
+// The phases may add to it from several threads.
+struct SolveStats {
+    struct Moves {
+        long long tried = 0;
+        long long feasible = 0; // the operator found a feasible move
+        long long accepted = 0;
+        long long improved = 0; // accepted and a new best
+    };
+
+    void add_duration(const string &stage, double seconds)
+    {
+        lock_guard<mutex> lock(m);
+        durations.push_back({stage, seconds});
+    }
+
+    void add_cpsat_status(const string &phase, const string &status)
+    {
+        lock_guard<mutex> lock(m);
+        ++cpsat_statuses[{phase, status}];
+    }
+
+    void add_moves(const string &neighborhood, const Moves &moves)
+    {
+        lock_guard<mutex> lock(m);
+        Moves &total = phase3_moves[neighborhood];
+        total.tried += moves.tried;
+        total.feasible += moves.feasible;
+        total.accepted += moves.accepted;
+        total.improved += moves.improved;
+    }
+
+    void add_phase3(long long tabu, long long restart_count)
+    {
+        lock_guard<mutex> lock(m);
+        tabu_hits += tabu;
+        restarts += restart_count;
+    }
+
+    mutable mutex m;
+    vector<pair<string, double>> durations;              // (stage, seconds), one entry per timed run
+    map<pair<string, string>, long long> cpsat_statuses; // (phase, status) -> solves
+    map<string, Moves> phase3_moves;                     // per neighborhood
+    long long tabu_hits = 0;                             // moves rejected as tabu
+    long long restarts = 0;                              // Phase 3 restarts from the best schedule
+};
+
+// Runtime hooks a caller can hand to Phase 2 and Phase 3
+struct SolveControl {
+    atomic<bool> *cancel = nullptr; // set to true to stop the solve, the best schedule so far is kept
+
+    // Called with every improved incumbent. Phase 3 may call it from several
+    // search threads (never concurrently) and throttles the calls.
+    function<void(const IncumbentUpdate &)> on_incumbent;
+
+    SolveStats *stats = nullptr; // optional, see SolveStats
+
+    bool cancelled() const { return cancel && cancel->load(memory_order_relaxed); }
+};
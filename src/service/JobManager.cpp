@@ -0,0 +1,332 @@
+#include "JobManager.h"
+#include "Metrics.h"
+#include "ResultCache.h"
+#include "../scheduler/repair.h"
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <iomanip>
+
+using namespace std;
+
+namespace
+{
+    string to_iso8601(chrono::system_clock::time_point tp)
+    {
+        time_t t = chrono::system_clock::to_time_t(tp);
+        tm utc;
+        gmtime_r(&t, &utc);
+        ostringstream oss;
+        oss << put_time(&utc, "%Y-%m-%dT%H:%M:%SZ");
+        return oss.str();
+    }
+
+    // Repairs depend on the previous schedule, so they bypass the result cache
+    json solve_repair(const json &request, const SolveControl &caller_ctl)
+    {
+        SolveStats stats;
+        struct RecordStats
+        {
+            SolveStats &stats;
+            ~RecordStats() { Metrics::instance().record(stats); }
+        } record{stats};
+        SolveControl ctl = caller_ctl;
+        ctl.stats = &stats;
+        RepairRequest req;
+        {
+            StageTimer timer("problem_init");
+            req = parse_repair_request(request);
+        }
+        return repair_to_json(repair_schedule(req, ctl));
+    }
+} // anonymous namespace
+
+JobManager &JobManager::instance()
+{
+    static JobManager manager;
+    return manager;
+}
+
+const char *JobManager::status_name(Status s)
+{
+    switch (s)
+    {
+    case Status::Queued:
+        return "queued";
+    case Status::Running:
+        return "running";
+    case Status::Succeeded:
+        return "succeeded";
+    case Status::Failed:
+        return "failed";
+    case Status::Cancelled:
+        return "cancelled";
+    }
+    return "unknown";
+}
+
+void JobManager::start(int workers, size_t queue_capacity, size_t max_finished)
+{
+    lock_guard<mutex> lock(m_);
+    if (running_)
+        return;
+    running_ = true;
+    queue_capacity_ = queue_capacity;
+    max_finished_ = max_finished;
+    for (int w = 0; w < max(1, workers); ++w)
+        workers_.emplace_back([this]
+                              { worker_loop(); });
+    cout << "[Jobs] Started " << workers_.size() << " solver workers, queue capacity " << queue_capacity_ << "\n";
+}
+
+void JobManager::stop()
+{
+    // queued jobs never reach a worker: finish them here so their listeners get "done"
+    vector<pair<string, Listener>> drained;
+    {
+        lock_guard<mutex> lock(m_);
+        if (!running_)
+            return;
+        running_ = false;
+        for (auto &entry : jobs_)
+            entry.second->cancel = true;
+        auto now = chrono::system_clock::now();
+        for (auto &job : queue_)
+        {
+            job->status = Status::Cancelled;
+            job->started = job->finished = now;
+            drained.push_back({job->id, std::move(job->listener)});
+            retire(job);
+        }
+        queue_.clear();
+    }
+    cv_.notify_all();
+    for (auto &entry : drained)
+        if (entry.second)
+            entry.second({{"event", "done"}, {"job_id", entry.first}, {"status", status_name(Status::Cancelled)}});
+    for (auto &t : workers_)
+        t.join();
+    workers_.clear();
+}
+
+string JobManager::new_job_id()
+{
+    // caller holds m_
+    static mt19937_64 gen(random_device{}());
+    ostringstream oss;
+    oss << hex << setw(8) << setfill('0') << (uint32_t)gen() << setw(6) << (next_seq_++ & 0xffffff);
+    return oss.str();
+}
+
+string JobManager::submit(json request, Listener listener, Kind kind)
+{
+    lock_guard<mutex> lock(m_);
+    if (!running_ || queue_.size() >= queue_capacity_)
+        return string();
+
+    auto job = make_shared<Job>();
+    job->id = new_job_id();
+    job->kind = kind;
+    job->request = std::move(request);
+    job->listener = std::move(listener);
+    job->created = chrono::system_clock::now();
+    jobs_[job->id] = job;
+    queue_.push_back(job);
+    // still under the lock, so no worker can start the job (and send
+    // "incumbent" or "done") before the listener has seen "queued"
+    if (job->listener)
+        job->listener({{"event", "queued"}, {"job_id", job->id}});
+    cv_.notify_one();
+    return job->id;
+}
+
+bool JobManager::describe(const string &id, json &out) const
+{
+    lock_guard<mutex> lock(m_);
+    auto it = jobs_.find(id);
+    if (it == jobs_.end())
+        return false;
+    const Job &job = *it->second;
+
+    out = json::object();
+    out["job_id"] = job.id;
+    out["status"] = status_name(job.status);
+    out["created_at"] = to_iso8601(job.created);
+    if (job.status == Status::Queued)
+    {
+        size_t pos = 0;
+        while (pos < queue_.size() && queue_[pos]->id != id)
+            ++pos;
+        out["queue_position"] = pos;
+    }
+    if (job.status != Status::Queued)
+        out["started_at"] = to_iso8601(job.started);
+    if (job.status != Status::Queued && job.status != Status::Running)
+        out["finished_at"] = to_iso8601(job.finished);
+    if (!job.incumbent.is_null())
+        out["incumbent"] = job.incumbent;
+    if (!job.result.is_null())
+        out["solution"] = job.result;
+    if (!job.report.is_null())
+        out["repair"] = job.report;
+    if (!job.error.empty())
+        out["message"] = job.error;
+    return true;
+}
+
+bool JobManager::cancel(const string &id)
+{
+    unique_lock<mutex> lock(m_);
+    auto it = jobs_.find(id);
+    if (it == jobs_.end())
+        return false;
+    auto job = it->second;
+    if (job->status == Status::Queued)
+    {
+        for (auto q = queue_.begin(); q != queue_.end(); ++q)
+            if ((*q)->id == id)
+            {
+                queue_.erase(q);
+                break;
+            }
+        job->status = Status::Cancelled;
+        job->started = job->finished = chrono::system_clock::now();
+        Listener listener = std::move(job->listener);
+        retire(job);
+        lock.unlock();
+        if (listener)
+            listener({{"event", "done"}, {"job_id", id}, {"status", status_name(Status::Cancelled)}});
+        return true;
+    }
+    if (job->status == Status::Running)
+    {
+        job->cancel = true;
+        return true;
+    }
+    return false;
+}
+
+bool JobManager::accept(const string &id)
+{
+    lock_guard<mutex> lock(m_);
+    auto it = jobs_.find(id);
+    if (it == jobs_.end() || it->second->status != Status::Running)
+        return false;
+    it->second->accepted = true;
+    it->second->cancel = true;
+    return true;
+}
+
+void JobManager::retire(const shared_ptr<Job> &job)
+{
+    // caller holds m_; forget the oldest finished jobs beyond max_finished_
+    job->request = json();
+    job->listener = nullptr;
+    finished_order_.push_back(job->id);
+    while (finished_order_.size() > max_finished_)
+    {
+        jobs_.erase(finished_order_.front());
+        finished_order_.pop_front();
+    }
+}
+
+void JobManager::worker_loop()
+{
+    for (;;)
+    {
+        shared_ptr<Job> job;
+        {
+            unique_lock<mutex> lock(m_);
+            cv_.wait(lock, [this]
+                     { return !running_ || !queue_.empty(); });
+            if (!running_)
+                return;
+            job = queue_.front();
+            queue_.pop_front();
+            job->status = Status::Running;
+            job->started = chrono::system_clock::now();
+        }
+        run_job(job);
+    }
+}
+
+void JobManager::run_job(const shared_ptr<Job> &job)
+{
+    json result, report;
+    string error;
+    bool invalid_request = false;
+    Status status = Status::Succeeded;
+    try
+    {
+        SolveControl ctl;
+        ctl.cancel = &job->cancel;
+        ctl.on_incumbent = [this, &job](const IncumbentUpdate &u)
+        {
+            json summary = {{"phase", u.phase},
+                            {"objective_value", u.objective_value},
+                            {"elapsed_seconds", u.elapsed_seconds}};
+            {
+                lock_guard<mutex> lock(m_);
+                job->incumbent = summary;
+            }
+            if (job->listener)
+            {
+                json event = summary;
+                event["event"] = "incumbent";
+                event["assignments"] = u.assignments;
+                job->listener(event);
+            }
+        };
+        json jout = job->kind == Kind::Repair ? solve_repair(job->request, ctl)
+                                              : ResultCache::instance().solve(job->request, ctl);
+        result = jout["solution"];
+        if (jout.contains("repair"))
+            report = jout["repair"];
+        if (job->cancel)
+            status = Status::Cancelled;
+    }
+    catch (const invalid_argument &ex)
+    {
+        status = Status::Failed;
+        error = ex.what();
+        invalid_request = true;
+    }
+    catch (const exception &ex)
+    {
+        status = job->cancel ? Status::Cancelled : Status::Failed;
+        error = ex.what();
+    }
+
+    Listener listener;
+    {
+        lock_guard<mutex> lock(m_);
+        if (status == Status::Cancelled && job->accepted && !result.is_null())
+            status = Status::Succeeded;
+        job->status = status;
+        job->result = result;
+        job->report = report;
+        job->error = error;
+        job->finished = chrono::system_clock::now();
+        listener = std::move(job->listener);
+        retire(job);
+    }
+    cout << "[Jobs] Job " << job->id << " " << status_name(status) << "\n";
+
+    if (listener)
+    {
+        json event;
+        event["event"] = "done";
+        event["job_id"] = job->id;
+        event["status"] = status_name(status);
+        if (!result.is_null())
+            event["solution"] = result;
+        if (!report.is_null())
+            event["repair"] = report;
+        if (!error.empty())
+            event["message"] = error;
+        if (invalid_request)
+            event["invalid_request"] = true;
+        listener(event);
+    }
+}
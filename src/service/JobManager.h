@@ -0,0 +1,105 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using json = nlohmann::json;
+using namespace std;
+
+// Background solver pool for /schedule/jobs. Requests wait in a bounded
+// queue and are solved by dedicated worker threads, so HTTP handlers only
+// enqueue and poll.
+class JobManager
+{
+public:
+    enum class Status
+    {
+        Queued,
+        Running,
+        Succeeded,
+        Failed,
+        Cancelled
+    };
+
+    // Receives {"event": "queued", "job_id": ...} first (from submit, with the
+    // queue locked, so it must not call back into JobManager), then
+    // {"event": "incumbent", ...} for each improved schedule and a final
+    // {"event": "done", ...}, which carries "invalid_request": true when the
+    // body was rejected (invalid_argument); these come from the solver thread
+    using Listener = function<void(const json &event)>;
+
+    static JobManager &instance();
+
+    // Start the worker threads; max_finished bounds how many completed jobs stay queryable
+    void start(int workers, size_t queue_capacity, size_t max_finished);
+
+    // Cancel everything still queued or running and join the workers; queued
+    // jobs finish as cancelled right away and their listeners get "done"
+    void stop();
+
+    enum class Kind
+    {
+        Schedule, // /schedule body, solved through the result cache
+        Repair    // /schedule/repair body, see repair.h
+    };
+
+    // Queue a request body for solving. Returns the job id, or an empty string when the queue is full.
+    string submit(json request, Listener listener = nullptr, Kind kind = Kind::Schedule);
+
+    // Status (and result once finished) of a job; false if the id is unknown
+    bool describe(const string &id, json &out) const;
+
+    // Ask a job to stop; false if the id is unknown or the job has already finished
+    bool cancel(const string &id);
+
+    // Stop a running job early and keep its current best schedule as a successful result
+    bool accept(const string &id);
+
+    static const char *status_name(Status s);
+
+private:
+    struct Job
+    {
+        string id;
+        Kind kind = Kind::Schedule;
+        Status status = Status::Queued;
+        json request;
+        json result;
+        json report; // "repair" object of a repair job
+        string error;
+        Listener listener;
+        json incumbent; // phase, objective and time of the latest improved schedule
+        atomic<bool> cancel{false};
+        bool accepted = false;
+        chrono::system_clock::time_point created;
+        chrono::system_clock::time_point started;
+        chrono::system_clock::time_point finished;
+    };
+
+    JobManager() = default;
+    void worker_loop();
+    void run_job(const shared_ptr<Job> &job);
+    void retire(const shared_ptr<Job> &job);
+    string new_job_id();
+
+    mutable mutex m_;
+    condition_variable cv_;
+    bool running_ = false;
+    size_t queue_capacity_ = 0;
+    size_t max_finished_ = 0;
+    deque<shared_ptr<Job>> queue_;
+    deque<string> finished_order_;
+    unordered_map<string, shared_ptr<Job>> jobs_;
+    vector<thread> workers_;
+    uint64_t next_seq_ = 0;
+};
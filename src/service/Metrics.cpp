@@ -0,0 +1,107 @@
+#include "Metrics.h"
+#include "ResultCache.h"
+#include <sstream>
+
+using namespace std;
+
+namespace
+{
+    void help(ostringstream &out, const char *name, const char *type, const char *text)
+    {
+        out << "# HELP " << name << " " << text << "\n"
+            << "# TYPE " << name << " " << type << "\n";
+    }
+} // anonymous namespace
+
+Metrics &Metrics::instance()
+{
+    static Metrics metrics;
+    return metrics;
+}
+
+void Metrics::observe(const string &stage, double seconds)
+{
+    lock_guard<mutex> lock(m_);
+    observe_locked(stage, seconds);
+}
+
+void Metrics::observe_locked(const string &stage, double seconds)
+{
+    Histogram &h = stages_[stage];
+    size_t b = 0;
+    while (b < kBuckets.size() && seconds > kBuckets[b])
+        ++b;
+    ++h.counts[b];
+    h.sum += seconds;
+    ++h.count;
+}
+
+void Metrics::record(const SolveStats &stats)
+{
+    lock_guard<mutex> stats_lock(stats.m);
+    lock_guard<mutex> lock(m_);
+    for (const auto &d : stats.durations)
+        observe_locked(d.first, d.second);
+    for (const auto &s : stats.cpsat_statuses)
+        cpsat_statuses_[s.first] += s.second;
+    for (const auto &nb : stats.phase3_moves)
+    {
+        SolveStats::Moves &total = phase3_moves_[nb.first];
+        total.tried += nb.second.tried;
+        total.feasible += nb.second.feasible;
+        total.accepted += nb.second.accepted;
+        total.improved += nb.second.improved;
+    }
+    tabu_hits_ += stats.tabu_hits;
+    restarts_ += stats.restarts;
+}
+
+string Metrics::render() const
+{
+    json cache = ResultCache::instance().stats();
+
+    lock_guard<mutex> lock(m_);
+    ostringstream out;
+
+    help(out, "scheduler_stage_duration_seconds", "histogram", "Duration of each request stage.");
+    for (const auto &[stage, h] : stages_)
+    {
+        uint64_t cumulative = 0;
+        for (size_t b = 0; b < kBuckets.size(); ++b)
+        {
+            cumulative += h.counts[b];
+            out << "scheduler_stage_duration_seconds_bucket{stage=\"" << stage << "\",le=\"" << kBuckets[b] << "\"} "
+                << cumulative << "\n";
+        }
+        out << "scheduler_stage_duration_seconds_bucket{stage=\"" << stage << "\",le=\"+Inf\"} " << h.count << "\n"
+            << "scheduler_stage_duration_seconds_sum{stage=\"" << stage << "\"} " << h.sum << "\n"
+            << "scheduler_stage_duration_seconds_count{stage=\"" << stage << "\"} " << h.count << "\n";
+    }
+
+    help(out, "scheduler_cpsat_solves_total", "counter", "CP-SAT solves by phase and final status.");
+    for (const auto &[key, n] : cpsat_statuses_)
+        out << "scheduler_cpsat_solves_total{phase=\"" << key.first << "\",status=\"" << key.second << "\"} " << n << "\n";
+
+    help(out, "scheduler_phase3_moves_total", "counter",
+         "Phase 3 moves per neighborhood: tried, feasible, accepted, and accepted with a new best (improved).");
+    for (const auto &[nb, moves] : phase3_moves_)
+    {
+        out << "scheduler_phase3_moves_total{neighborhood=\"" << nb << "\",result=\"tried\"} " << moves.tried << "\n"
+            << "scheduler_phase3_moves_total{neighborhood=\"" << nb << "\",result=\"feasible\"} " << moves.feasible << "\n"
+            << "scheduler_phase3_moves_total{neighborhood=\"" << nb << "\",result=\"accepted\"} " << moves.accepted << "\n"
+            << "scheduler_phase3_moves_total{neighborhood=\"" << nb << "\",result=\"improved\"} " << moves.improved << "\n";
+    }
+
+    help(out, "scheduler_phase3_tabu_hits_total", "counter", "Phase 3 moves rejected by the tabu list.");
+    out << "scheduler_phase3_tabu_hits_total " << tabu_hits_ << "\n";
+    help(out, "scheduler_phase3_restarts_total", "counter", "Phase 3 restarts from the best schedule.");
+    out << "scheduler_phase3_restarts_total " << restarts_ << "\n";
+
+    help(out, "scheduler_cache_requests_total", "counter", "Result cache lookups by outcome.");
+    for (const char *outcome : {"hits", "misses", "coalesced"})
+        out << "scheduler_cache_requests_total{outcome=\"" << outcome << "\"} " << cache[outcome].get<uint64_t>() << "\n";
+    help(out, "scheduler_cache_entries", "gauge", "Results currently stored in the cache.");
+    out << "scheduler_cache_entries " << cache["size"].get<uint64_t>() << "\n";
+
+    return out.str();
+}
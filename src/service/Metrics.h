@@ -0,0 +1,64 @@
+#pragma once
+
+#include "../scheduler/solve_control.h"
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+
+using namespace std;
+
+// Process-wide solver metrics in the Prometheus text format, served by /metrics.
+// Stage durations are histograms; CP-SAT statuses and Phase 3 moves are counters.
+class Metrics
+{
+public:
+    static Metrics &instance();
+
+    // One run of a stage, e.g. "json_parse" or "response_serialize"
+    void observe(const string &stage, double seconds);
+
+    // Everything a solve collected in its SolveStats
+    void record(const SolveStats &stats);
+
+    // Prometheus exposition text, including the result cache counters
+    string render() const;
+
+private:
+    static constexpr array<double, 13> kBuckets = {0.001, 0.005, 0.01, 0.05, 0.1, 0.5, 1, 2.5, 5, 10, 30, 60, 120};
+
+    struct Histogram
+    {
+        array<uint64_t, kBuckets.size() + 1> counts{}; // last one is +Inf
+        double sum = 0;
+        uint64_t count = 0;
+    };
+
+    Metrics() = default;
+    void observe_locked(const string &stage, double seconds); // caller holds m_
+
+    mutable mutex m_;
+    map<string, Histogram> stages_;
+    map<pair<string, string>, uint64_t> cpsat_statuses_; // (phase, status)
+    map<string, SolveStats::Moves> phase3_moves_;        // per neighborhood
+    uint64_t tabu_hits_ = 0;
+    uint64_t restarts_ = 0;
+};
+
+// Adds the lifetime of the scope to a stage histogram
+class StageTimer
+{
+public:
+    explicit StageTimer(string stage) : stage_(std::move(stage)), start_(chrono::steady_clock::now()) {}
+    ~StageTimer()
+    {
+        Metrics::instance().observe(stage_, chrono::duration<double>(chrono::steady_clock::now() - start_).count());
+    }
+
+private:
+    string stage_;
+    chrono::steady_clock::time_point start_;
+};
@@ -0,0 +1,179 @@
+#include "ResultCache.h"
+#include "Metrics.h"
+#include "../scheduler/objective.h"
+#include <iostream>
+#include <stdexcept>
+
+using namespace std;
+
+namespace
+{
+    json make_response(const OptimalSolution &solution, bool cached)
+    {
+        json jout;
+        jout["status"] = "success";
+        jout["solution"] = solution_to_json(solution);
+        jout["cached"] = cached;
+        return jout;
+    }
+
+    // Phase 2 can end without a schedule (INFEASIBLE, or UNKNOWN at its time
+    // limit) and then hands an empty one on; only a schedule that places every
+    // section within the hard constraints is worth serving for the whole TTL.
+    bool is_feasible(const CompiledProblem &cp, const OptimalSolution &solution)
+    {
+        return check_constraints(cp, to_placements(cp, solution.assignments), 1).empty();
+    }
+
+    // Hands a solve's stats to /metrics however the request ends
+    struct RecordStats
+    {
+        SolveStats &stats;
+        ~RecordStats() { Metrics::instance().record(stats); }
+    };
+} // anonymous namespace
+
+ResultCache &ResultCache::instance()
+{
+    static ResultCache cache;
+    return cache;
+}
+
+void ResultCache::configure(size_t capacity, double ttl_seconds)
+{
+    lock_guard<mutex> lock(m_);
+    capacity_ = capacity;
+    ttl_seconds_ = ttl_seconds;
+    while (lru_.size() > capacity_)
+    {
+        entries_.erase(lru_.back().key);
+        lru_.pop_back();
+    }
+    cout << "[Cache] Capacity " << capacity_ << " results, TTL " << ttl_seconds_ << "s\n";
+}
+
+bool ResultCache::lookup(const string &key, OptimalSolution &out)
+{
+    auto it = entries_.find(key);
+    if (it == entries_.end())
+        return false;
+    auto age = chrono::duration<double>(chrono::steady_clock::now() - it->second->stored).count();
+    if (ttl_seconds_ > 0 && age > ttl_seconds_)
+    {
+        lru_.erase(it->second);
+        entries_.erase(it);
+        return false;
+    }
+    lru_.splice(lru_.begin(), lru_, it->second);
+    out = it->second->solution;
+    return true;
+}
+
+void ResultCache::store(const string &key, const OptimalSolution &solution)
+{
+    if (capacity_ == 0)
+        return;
+    auto it = entries_.find(key);
+    if (it != entries_.end())
+    {
+        lru_.erase(it->second);
+        entries_.erase(it);
+    }
+    lru_.push_front({key, solution, chrono::steady_clock::now()});
+    entries_[key] = lru_.begin();
+    while (lru_.size() > capacity_)
+    {
+        entries_.erase(lru_.back().key);
+        lru_.pop_back();
+    }
+}
+
+json ResultCache::solve(const json &jin, const SolveControl &caller_ctl)
+{
+    SolveStats stats;
+    RecordStats record{stats};
+    SolveControl ctl = caller_ctl;
+    ctl.stats = &stats;
+
+    auto init_start = chrono::steady_clock::now();
+    ScheduleRequest req = parse_schedule_request(jin);
+    stats.add_duration("problem_init", chrono::duration<double>(chrono::steady_clock::now() - init_start).count());
+    if (!req.options.value("cache", true))
+        return make_response(solve_schedule(req, ctl), false);
+
+    string key = request_hash(req);
+    for (;;)
+    {
+        shared_ptr<InFlight> flight;
+        {
+            unique_lock<mutex> lock(m_);
+            OptimalSolution cached;
+            if (lookup(key, cached))
+            {
+                ++hits_;
+                return make_response(cached, true);
+            }
+
+            auto it = in_flight_.find(key);
+            if (it != in_flight_.end())
+            {
+                // an identical request is being solved: wait for it, but keep honouring our own cancel flag
+                flight = it->second;
+                ++coalesced_;
+                while (!flight->done)
+                {
+                    if (ctl.cancelled())
+                        throw runtime_error("cancelled while waiting for an identical request");
+                    done_cv_.wait_for(lock, chrono::milliseconds(100));
+                }
+                if (flight->retry)
+                    continue;
+                if (flight->error)
+                    rethrow_exception(flight->error);
+                return make_response(flight->solution, true);
+            }
+
+            flight = make_shared<InFlight>();
+            in_flight_[key] = flight;
+            ++misses_;
+        }
+
+        OptimalSolution solution;
+        exception_ptr error;
+        try
+        {
+            solution = solve_schedule(req, ctl);
+        }
+        catch (...)
+        {
+            error = current_exception();
+        }
+
+        {
+            lock_guard<mutex> lock(m_);
+            in_flight_.erase(key);
+            flight->done = true;
+            // a cancelled (or accepted early) solve is not the answer to the request
+            flight->retry = ctl.cancelled();
+            flight->solution = solution;
+            flight->error = error;
+            if (!error && !ctl.cancelled() && is_feasible(req.data.compiled, solution))
+                store(key, solution);
+        }
+        done_cv_.notify_all();
+
+        if (error)
+            rethrow_exception(error);
+        return make_response(solution, false);
+    }
+}
+
+json ResultCache::stats() const
+{
+    lock_guard<mutex> lock(m_);
+    return {{"hits", hits_},
+            {"misses", misses_},
+            {"coalesced", coalesced_},
+            {"size", lru_.size()},
+            {"capacity", capacity_}};
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "../scheduler/pipeline.h"
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+using namespace std;
+
+// In-memory LRU cache of solved requests keyed by request_hash(), shared by
+// /schedule and /schedule/jobs. Identical requests that arrive while one is
+// still being solved wait for that solve instead of starting their own.
+class ResultCache
+{
+public:
+    static ResultCache &instance();
+
+    // capacity 0 disables storing results (in-flight requests are still coalesced);
+    // ttl_seconds 0 keeps entries until they are evicted
+    void configure(size_t capacity, double ttl_seconds);
+
+    // Same as solve_schedule_request, answered from the cache when possible.
+    // The response carries "cached": true when no new solve was run for it.
+    // A request with options.cache = false bypasses the cache.
+    json solve(const json &jin, const SolveControl &ctl = SolveControl());
+
+    // hits, misses, coalesced requests and current size
+    json stats() const;
+
+private:
+    struct Entry
+    {
+        string key;
+        OptimalSolution solution;
+        chrono::steady_clock::time_point stored;
+    };
+
+    // A solve other identical requests can wait on
+    struct InFlight
+    {
+        bool done = false;
+        bool retry = false; // the solve was cancelled, waiters solve again themselves
+        OptimalSolution solution;
+        exception_ptr error;
+    };
+
+    ResultCache() = default;
+    bool lookup(const string &key, OptimalSolution &out); // caller holds m_
+    void store(const string &key, const OptimalSolution &solution); // caller holds m_
+
+    mutable mutex m_;
+    condition_variable done_cv_;
+    size_t capacity_ = 0;
+    double ttl_seconds_ = 0;
+    list<Entry> lru_; // most recently used first
+    unordered_map<string, list<Entry>::iterator> entries_;
+    unordered_map<string, shared_ptr<InFlight>> in_flight_;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+    uint64_t coalesced_ = 0;
+};
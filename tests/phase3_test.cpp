@@ -0,0 +1,121 @@
+// phase3_test: Phase 3 on a generated instance with several searches.
+//   - for each cooling schedule, the result recomputed from scratch
+//     (verify) is feasible and has the objective the search tracked by deltas
+//   - two runs with the same seed return the same schedule
+//   - a search thread whose incumbent callback throws makes
+//     find_optimal_solution rethrow instead of leaving the other searches
+//     waiting at the exchange barrier
+//
+//   phase3_test
+#include "instance_generator.h"
+#include "scheduler/phase2.h"
+#include "scheduler/phase3.h"
+#include <atomic>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+using namespace std;
+
+namespace
+{
+    int failures = 0;
+
+    void check(bool ok, const string &what)
+    {
+        if (!ok)
+        {
+            cerr << "FAIL: " << what << "\n";
+            ++failures;
+        }
+    }
+
+    Phase3Options search_options(int threads)
+    {
+        Phase3Options opts;
+        opts.threads = threads;
+        opts.exchange_interval = 10;
+        opts.has_seed = true;
+        opts.seed = 1;
+        opts.max_iterations = 400;
+        opts.time_limit_seconds = 30;
+        opts.progress_interval_seconds = 0;
+        return opts;
+    }
+
+    void verified(const ProblemData &data, const InitialSolution &initial, const string &cooling)
+    {
+        Phase3Options opts = search_options(4);
+        opts.cooling = cooling;
+        opts.verify = true;
+        OptimalSolution first = find_optimal_solution(data, initial, opts);
+        const json &v = first.verification;
+        check(v.value("feasible", false), cooling + ": result is feasible");
+        check(v.value("matches_search", false), cooling + ": delta objective matches evaluate_objective");
+        check(first.objective_value >= v.value("initial_objective", 0), cooling + ": result is no worse than the start");
+
+        OptimalSolution second = find_optimal_solution(data, initial, opts);
+        bool same = second.objective_value == first.objective_value &&
+                    second.assignments.size() == first.assignments.size();
+        for (size_t k = 0; same && k < first.assignments.size(); ++k)
+        {
+            const auto &a = first.assignments[k];
+            const auto &b = second.assignments[k];
+            same = a.teacher_id == b.teacher_id && a.course_id == b.course_id && a.section_id == b.section_id &&
+                   a.day == b.day && a.period == b.period;
+        }
+        check(same, cooling + ": a seeded run is reproducible");
+    }
+
+    void throwing_worker(const ProblemData &data, const InitialSolution &initial)
+    {
+        thread::id caller = this_thread::get_id();
+        atomic<bool> thrown{false};
+        SolveControl ctl;
+        ctl.on_incumbent = [&](const IncumbentUpdate &)
+        {
+            if (this_thread::get_id() == caller)
+                return;
+            thrown = true;
+            throw runtime_error("listener failed");
+        };
+        bool rethrown = false;
+        try
+        {
+            find_optimal_solution(data, initial, search_options(4), ctl);
+        }
+        catch (const runtime_error &ex)
+        {
+            rethrown = string(ex.what()) == "listener failed";
+        }
+        check(thrown, "a search thread reported an incumbent");
+        check(rethrown, "the exception of the search thread reaches the caller");
+    }
+} // anonymous namespace
+
+int main()
+{
+    GeneratorOptions gen;
+    ProblemData data = initialize_problem_from_json(generate_instance(gen));
+
+    Phase2Options phase2;
+    phase2.time_limit_seconds = 10;
+    phase2.workers = 1;
+    phase2.has_seed = true;
+    phase2.seed = 1;
+    phase2.stop_after_first_solution = true; // leave room for Phase 3 to improve
+    InitialSolution initial = construct_initial_solution(data, phase2);
+    if (initial.assignments.empty())
+    {
+        cerr << "phase3_test: Phase 2 found no schedule for the generated instance\n";
+        return 2;
+    }
+
+    for (const char *cooling : {"geometric", "lundy_mees"})
+        verified(data, initial, cooling);
+    throwing_worker(data, initial);
+
+    if (failures == 0)
+        cout << "phase3_test: OK\n";
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,75 @@
+// repair_test: a room closure naming a day, a period or a room count the
+// problem does not have is rejected instead of being silently ignored, and
+// one on a day without classrooms_per_slot (no rooms) is accepted.
+//
+//   repair_test REQUEST.json
+#include "scheduler/repair.h"
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+using namespace std;
+
+namespace
+{
+    int failures = 0;
+
+    void check(bool ok, const string &what)
+    {
+        if (!ok)
+        {
+            cerr << "FAIL: " << what << "\n";
+            ++failures;
+        }
+    }
+
+    bool rejected(json jin, const json &change)
+    {
+        jin["changes"] = json::array({change});
+        try
+        {
+            parse_repair_request(jin);
+        }
+        catch (const invalid_argument &)
+        {
+            return true;
+        }
+        return false;
+    }
+} // anonymous namespace
+
+int main(int argc, char **argv)
+{
+    if (argc != 2)
+    {
+        cerr << "usage: repair_test REQUEST.json\n";
+        return 2;
+    }
+    ifstream in(argv[1]);
+    if (!in)
+    {
+        cerr << "cannot open " << argv[1] << "\n";
+        return 2;
+    }
+    json jin = json::parse(in);
+    jin["previous_solution"] = {{"assignments", json::array()}};
+
+    string day = jin["classrooms"]["days"][0];
+    string period = jin["classrooms"]["periods"][0];
+
+    check(rejected(jin, {{"type", "room_closure"}, {"day", day + "x"}}), "unknown day is rejected");
+    check(rejected(jin, {{"type", "room_closure"}, {"day", day}, {"periods", {period + "x"}}}),
+          "unknown period is rejected");
+    check(rejected(jin, {{"type", "room_closure"}, {"day", day}, {"rooms", -1}}), "negative rooms is rejected");
+    check(!rejected(jin, {{"type", "room_closure"}, {"day", day}, {"periods", {period}}, {"rooms", 1}}),
+          "closure of a known slot is accepted");
+
+    json no_rooms = jin;
+    no_rooms["classrooms"]["classrooms_per_slot"].erase(day);
+    check(!rejected(no_rooms, {{"type", "room_closure"}, {"day", day}, {"rooms", 1}}),
+          "closure of a day missing from classrooms_per_slot is accepted");
+
+    if (failures == 0)
+        cout << "repair_test: OK\n";
+    return failures == 0 ? 0 : 1;
+}
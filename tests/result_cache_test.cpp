@@ -0,0 +1,66 @@
+// result_cache_test: a solved request (with multi-period sections) is stored
+// and the identical request that follows is answered from the cache.
+//
+//   result_cache_test REQUEST.json
+#include "service/ResultCache.h"
+#include <fstream>
+#include <iostream>
+
+using namespace std;
+
+namespace
+{
+    int failures = 0;
+
+    void check(bool ok, const string &what)
+    {
+        if (!ok)
+        {
+            cerr << "FAIL: " << what << "\n";
+            ++failures;
+        }
+    }
+} // anonymous namespace
+
+int main(int argc, char **argv)
+{
+    if (argc != 2)
+    {
+        cerr << "usage: result_cache_test REQUEST.json\n";
+        return 2;
+    }
+    ifstream in(argv[1]);
+    if (!in)
+    {
+        cerr << "cannot open " << argv[1] << "\n";
+        return 2;
+    }
+    json jin = json::parse(in);
+    jin["options"]["phase2"] = {{"time_limit_seconds", 10}, {"workers", 1}};
+    jin["options"]["phase3"] = {{"max_iterations", 200}, {"seed", 1}};
+
+    bool multi_period = false;
+    for (const auto &course : jin["courses"])
+        for (const auto &section : course["sections"])
+            multi_period |= section.value("required_periods", 1) > 1;
+    check(multi_period, "the request has a section with required_periods > 1");
+
+    ResultCache &cache = ResultCache::instance();
+    cache.configure(8, 0);
+
+    json first = cache.solve(jin);
+    check(first["status"] == "success", "first solve succeeds");
+    check(!first["solution"]["assignments"].empty(), "first solve returns a schedule");
+    check(first.value("cached", true) == false, "first solve is not cached");
+
+    json second = cache.solve(jin);
+    check(second.value("cached", false) == true, "second solve is answered from the cache");
+    check(second["solution"] == first["solution"], "cached solution equals the first one");
+
+    json stats = cache.stats();
+    check(stats["hits"] == 1 && stats["misses"] == 1 && stats["size"] == 1, "stats: 1 hit, 1 miss, 1 entry");
+
+    if (failures == 0)
+        cout << "result_cache_test: OK\n";
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,106 @@
+// snapshot_test: a compiled problem written to a snapshot and read back
+// describes the same problem (same problem_hash through problem_to_json),
+// and a truncated snapshot or one with a corrupted count is rejected.
+//
+//   snapshot_test REQUEST.json SCRATCH_PATH
+#include "scheduler/snapshot.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    int failures = 0;
+
+    void check(bool ok, const string &what)
+    {
+        if (!ok)
+        {
+            cerr << "FAIL: " << what << "\n";
+            ++failures;
+        }
+    }
+
+    vector<char> read_bytes(const string &path)
+    {
+        ifstream in(path, ios::binary);
+        return vector<char>(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    }
+
+    void write_bytes(const string &path, const vector<char> &bytes)
+    {
+        ofstream out(path, ios::binary | ios::trunc);
+        out.write(bytes.data(), (streamsize)bytes.size());
+    }
+
+    bool rejected(const string &path)
+    {
+        try
+        {
+            read_snapshot(path);
+        }
+        catch (const runtime_error &)
+        {
+            return true;
+        }
+        return false;
+    }
+
+    // Hash of the problem as problem_to_json sees it (names are not stored)
+    string compiled_hash(const CompiledProblem &cp)
+    {
+        return problem_hash(initialize_problem_from_json(problem_to_json(cp)));
+    }
+} // anonymous namespace
+
+int main(int argc, char **argv)
+{
+    if (argc != 3)
+    {
+        cerr << "usage: snapshot_test REQUEST.json SCRATCH_PATH\n";
+        return 2;
+    }
+    ifstream in(argv[1]);
+    if (!in)
+    {
+        cerr << "cannot open " << argv[1] << "\n";
+        return 2;
+    }
+    const string path = argv[2];
+    ProblemData data = initialize_problem_from_json(json::parse(in));
+
+    write_snapshot(data.compiled, path);
+    check(is_snapshot(path), "written file starts with the snapshot magic");
+    CompiledProblem loaded = read_snapshot(path);
+    check(loaded.time_pref == data.compiled.time_pref && loaded.capacity == data.compiled.capacity &&
+              loaded.section_required_periods == data.compiled.section_required_periods &&
+              loaded.course_eligible_teachers == data.compiled.course_eligible_teachers,
+          "arrays read back equal the written ones");
+    check(compiled_hash(loaded) == compiled_hash(data.compiled), "round trip keeps the problem_hash");
+
+    vector<char> bytes = read_bytes(path);
+
+    write_bytes(path, vector<char>(bytes.begin(), bytes.begin() + bytes.size() / 2));
+    check(rejected(path), "truncated snapshot is rejected");
+
+    // num_sections follows magic[8], version, byte_order, file_size, num_teachers, num_courses
+    const size_t num_sections_offset = 8 + 4 + 4 + 8 + 4 + 4;
+    vector<char> corrupted = bytes;
+    int32_t sections;
+    memcpy(&sections, corrupted.data() + num_sections_offset, sizeof(sections));
+    sections += 1;
+    memcpy(corrupted.data() + num_sections_offset, &sections, sizeof(sections));
+    write_bytes(path, corrupted);
+    check(rejected(path), "snapshot with a corrupted section count is rejected");
+
+    remove(path.c_str());
+    if (failures == 0)
+        cout << "snapshot_test: OK\n";
+    return failures == 0 ? 0 : 1;
+}